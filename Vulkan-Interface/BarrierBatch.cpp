@@ -0,0 +1,168 @@
+#include "MYR.h"
+
+using namespace MYR;
+
+namespace
+{
+    struct StateInfo
+    {
+        VkPipelineStageFlags2 stages;
+        VkAccessFlags2 access;
+        VkImageLayout layout;
+    };
+
+    //only bits that also exist in the legacy flags are used, so the fallback path can narrow them to 32 bits
+    const StateInfo stateTable[] =
+    {
+        /*Undefined*/          { VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED },
+        /*TransferSrc*/        { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL },
+        /*TransferDst*/        { VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL },
+        /*VertexShaderRead*/   { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+        /*FragmentShaderRead*/ { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+        /*ComputeShaderRead*/  { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+        /*ComputeShaderWrite*/ { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL },
+        /*ColorAttachment*/    { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+        /*DepthAttachment*/    { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+                                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL },
+        /*DepthRead*/          { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL },
+        /*Present*/            { VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR },
+        /*VertexBuffer*/       { VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT, VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED },
+        /*IndexBuffer*/        { VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT, VK_ACCESS_2_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED },
+        /*UniformBuffer*/      { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED },
+        /*HostWrite*/          { VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED },
+        /*HostRead*/           { VK_PIPELINE_STAGE_2_HOST_BIT, VK_ACCESS_2_HOST_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED },
+    };
+
+    const StateInfo& infoOf(ResourceState state)
+    {
+        return stateTable[static_cast<size_t>(state)];
+    }
+
+    //reads need no availability operation, only writes are made available to the next access
+    VkAccessFlags2 writesOf(VkAccessFlags2 access)
+    {
+        return access & (VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT);
+    }
+}
+
+BarrierBatch::BarrierBatch(Device device) : device(device) {}
+
+void BarrierBatch::transition(VkImage image, VkImageAspectFlags aspectMask, ResourceState from, ResourceState to, uint32_t baseMipLevel, uint32_t levelCount)
+{
+    const StateInfo& src = infoOf(from);
+    const StateInfo& dst = infoOf(to);
+
+    VkImageMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = src.stages;
+    barrier.srcAccessMask = writesOf(src.access);
+    barrier.dstStageMask = dst.stages;
+    barrier.dstAccessMask = dst.access;
+    barrier.oldLayout = src.layout;
+    barrier.newLayout = dst.layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = { aspectMask, baseMipLevel, levelCount, 0, VK_REMAINING_ARRAY_LAYERS };
+    imageBarriers.push_back(barrier);
+}
+
+void BarrierBatch::alias(VkImage image, VkImageAspectFlags aspectMask, ResourceState previousOccupant, ResourceState to)
+{
+    //waits for the previous user of the memory, the old contents belong to another image and are discarded
+    transition(image, aspectMask, previousOccupant, to);
+    imageBarriers.back().oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+void BarrierBatch::transition(VkBuffer buffer, ResourceState from, ResourceState to, VkDeviceSize offset, VkDeviceSize size)
+{
+    const StateInfo& src = infoOf(from);
+    const StateInfo& dst = infoOf(to);
+
+    VkBufferMemoryBarrier2 barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    barrier.srcStageMask = src.stages;
+    barrier.srcAccessMask = writesOf(src.access);
+    barrier.dstStageMask = dst.stages;
+    barrier.dstAccessMask = dst.access;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+    bufferBarriers.push_back(barrier);
+}
+
+void BarrierBatch::flush(VkCommandBuffer commandBuffer)
+{
+    if (empty())
+        return;
+
+    if (device->supportsSynchronization2())
+    {
+        VkDependencyInfo dependencyInfo{};
+        dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(imageBarriers.size());
+        dependencyInfo.pImageMemoryBarriers = imageBarriers.data();
+        dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(bufferBarriers.size());
+        dependencyInfo.pBufferMemoryBarriers = bufferBarriers.data();
+        vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    }
+    else
+    {
+        //the legacy call takes one stage pair for the whole batch, so the per-barrier stages are merged
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+
+        std::vector<VkImageMemoryBarrier> legacyImageBarriers;
+        for (VkImageMemoryBarrier2& barrier2 : imageBarriers)
+        {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = static_cast<VkAccessFlags>(barrier2.srcAccessMask);
+            barrier.dstAccessMask = static_cast<VkAccessFlags>(barrier2.dstAccessMask);
+            barrier.oldLayout = barrier2.oldLayout;
+            barrier.newLayout = barrier2.newLayout;
+            barrier.srcQueueFamilyIndex = barrier2.srcQueueFamilyIndex;
+            barrier.dstQueueFamilyIndex = barrier2.dstQueueFamilyIndex;
+            barrier.image = barrier2.image;
+            barrier.subresourceRange = barrier2.subresourceRange;
+            legacyImageBarriers.push_back(barrier);
+
+            srcStages |= static_cast<VkPipelineStageFlags>(barrier2.srcStageMask);
+            dstStages |= static_cast<VkPipelineStageFlags>(barrier2.dstStageMask);
+        }
+
+        std::vector<VkBufferMemoryBarrier> legacyBufferBarriers;
+        for (VkBufferMemoryBarrier2& barrier2 : bufferBarriers)
+        {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = static_cast<VkAccessFlags>(barrier2.srcAccessMask);
+            barrier.dstAccessMask = static_cast<VkAccessFlags>(barrier2.dstAccessMask);
+            barrier.srcQueueFamilyIndex = barrier2.srcQueueFamilyIndex;
+            barrier.dstQueueFamilyIndex = barrier2.dstQueueFamilyIndex;
+            barrier.buffer = barrier2.buffer;
+            barrier.offset = barrier2.offset;
+            barrier.size = barrier2.size;
+            legacyBufferBarriers.push_back(barrier);
+
+            srcStages |= static_cast<VkPipelineStageFlags>(barrier2.srcStageMask);
+            dstStages |= static_cast<VkPipelineStageFlags>(barrier2.dstStageMask);
+        }
+
+        vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr,
+            static_cast<uint32_t>(legacyBufferBarriers.size()), legacyBufferBarriers.data(),
+            static_cast<uint32_t>(legacyImageBarriers.size()), legacyImageBarriers.data());
+    }
+
+    imageBarriers.clear();
+    bufferBarriers.clear();
+}
+
+VkImageLayout BarrierBatch::layoutOf(ResourceState state)
+{
+    return infoOf(state).layout;
+}
@@ -8,8 +8,14 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <chrono>
+#include <algorithm>
 
+//release builds skip the layers, they distort timings and are often missing on CI machines
+#ifdef NDEBUG
+const bool enableValidationLayers{ false };
+#else
 const bool enableValidationLayers{ true };
+#endif
 
 struct UniformBufferObject
 {
@@ -22,7 +28,8 @@ class BaseApp
 {
 public:
 
-    const int MAX_FRAMES_IN_FLIGHT{ 2 };
+    //per-frame resources are created for the largest depth, setFramesInFlight picks how many of them are cycled
+    const int MAX_FRAMES_IN_FLIGHT{ 4 };
 
     std::vector<MYR::Vertex> vertices{};
     std::vector<uint32_t> indices{};
@@ -36,33 +43,58 @@ public:
         pipeline(new MYR::Pipeline_T(device.get())),
         command(new MYR::Command_T(device.get(), pipeline.get(), swapChain.get(), MAX_FRAMES_IN_FLIGHT)),
         syncManager(new MYR::SyncManager_T(device.get())),
+        deletionQueue(new MYR::DeletionQueue_T()),
         imageManager(new MYR::ImageManager_T(device.get(), command.get())),
         bufferManager(new MYR::BufferManager_T(device.get(), command.get())),
         buffers(new MYR::Buffers_T(device.get(), pipeline.get(), command.get(), MAX_FRAMES_IN_FLIGHT)),
+        descriptorLayoutCache(new MYR::DescriptorLayoutCache_T(device.get())),
+        descriptorAllocator(new MYR::DescriptorAllocator_T(device.get(), MAX_FRAMES_IN_FLIGHT)),
+        bindlessSet(new MYR::BindlessSet_T(device.get())),
+        gpuProfiler(new MYR::GpuProfiler_T(device.get(), MAX_FRAMES_IN_FLIGHT)),
         camera(new Camera())
     {}
     ~BaseApp() { cleanup(); }
 
     void initComponents()
     {
-        window->initWindow();
+        if (!useHeadless)
+            window->initWindow();
         initVulkan();
-        control = Control::makeControl(window->getHandle());
+        if (!useHeadless)
+            control = Control::makeControl(window->getHandle());
     }
 
     void run()
     {
-        while (!glfwWindowShouldClose(window->getHandle()))
+        while (!shouldClose())
         {
-            glfwPollEvents();
-            control->update_camera(camera.get(), 20, 5);
+            {
+                MYR_PROFILE_ZONE("FrameLimiter");
+                frameLimiter.wait();
+            }
+            pollInput();
             doFrame();
+            MYR_PROFILE_FRAME();
         }
+        drainReadbacks();
+    }
+
+    //Renders count frames, or fewer if close_window is called, headless frames are only paced when a frame rate limit is set
+    void runFrames(uint64_t count)
+    {
+        for (uint64_t i = 0; i < count && !shouldClose(); i++)
+        {
+            frameLimiter.wait();
+            pollInput();
+            doFrame();
+            MYR_PROFILE_FRAME();
+        }
+        drainReadbacks();
     }
 
     void run_with_update_function(bool (*f)(double delta_T), float f_call_time)
     {
-        while (!glfwWindowShouldClose(window->getHandle()))
+        while (!shouldClose())
         {
             static std::chrono::steady_clock::time_point  startTime = std::chrono::high_resolution_clock::now();
             static float f_call_time_ellapsed{ 0 };
@@ -78,29 +110,110 @@ public:
                 if (changes_made) flush_mesh_update();
             }
 
-            glfwPollEvents();
-            control->update_camera(camera.get(), 20, 5);
+            {
+                MYR_PROFILE_ZONE("FrameLimiter");
+                frameLimiter.wait();
+            }
+            pollInput();
             doFrame();
+            MYR_PROFILE_FRAME();
         }
+        drainReadbacks();
     }
 
     void flush_mesh_update()
     {
-        vkWaitForFences(device->getHandle(), 1, &inFlightFences[(currentFrame + 1) % MAX_FRAMES_IN_FLIGHT], VK_TRUE, UINT64_MAX);
+        MYR_PROFILE_FUNCTION();
+        //no fence wait, the old buffer goes through the deletion queue and outlives the frames still reading it
         if (buffers->getVIBuffer() != NULL)
+        {
             bufferManager->destroyBuffer(buffers->getVIBuffer());
+            //frames in flight still read the old bindless slot, the rebuilt mesh gets a new one and the old slot is freed after them
+            uint32_t oldIndex = buffers->getVIBufferIndex();
+            if (oldIndex != UINT32_MAX)
+                deletionQueue->push([bindless = bindlessSet.get(), oldIndex]() { bindless->removeBuffer(oldIndex); });
+        }
         buffers->createVIBuffer(bufferManager.get(), vertices, indices);
     }
     VkExtent2D getWindowExtent() { return swapChain->getExtent(); }
-    void close_window() { window->close_window(); }
+    void close_window()
+    {
+        if (useHeadless)
+            closeRequested = true;
+        else
+            window->close_window();
+    }
+
+    //returns the index setPushConstant takes, p.data is copied as the initial value
+    size_t createPushConstant(MYR::PushConstant p)
+    {
+        return pipeline->addPushConstant(p);
+    }
+    void setPushConstant(size_t index, const void* data) { pipeline->getPushConstantBlock().set(index, data); }
 
-    void createPushConstant(MYR::PushConstant p)
+    //Uploads are batched and submitted ahead of the next frame, the image is in SHADER_READ_ONLY_OPTIMAL by the time it is sampled
+    MYR::Texture createTexture(uint32_t width, uint32_t height, VkFormat format, const void* pixels, VkDeviceSize size, bool generateMipmaps = true)
+    {
+        return imageManager->createTexture(width, height, format, pixels, size, generateMipmaps);
+    }
+    void destroyTexture(MYR::Texture& texture) { imageManager->destroyTexture(texture); }
+    VkSampler createSampler(uint32_t mipLevels) { return imageManager->createSampler(mipLevels); }
+
+    //Call before initComponents, shaders then read resources from set 1 by the indices the bindless set hands out
+    void enableBindless() { useBindless = true; }
+    MYR::BindlessSet getBindlessSet() { return useBindless ? bindlessSet.get() : nullptr; }
+    uint32_t getVIBufferIndex() { return buffers->getVIBufferIndex(); } //changes with every flush_mesh_update
+
+    //1 gives the lowest input latency, 3 or 4 the most CPU/GPU overlap, applied between frames
+    void setFramesInFlight(uint32_t count) { pendingFramesInFlight = std::clamp(count, 1u, static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT)); }
+    uint32_t getFramesInFlight() { return framesInFlight; }
+    //0 removes the limit
+    void setFrameRateLimit(double framesPerSecond) { frameLimiter.setTargetFrameRate(framesPerSecond); }
+    //Work that must not outlive a frame can wait on frameTimeline reaching getSubmittedFrame()
+    VkSemaphore getFrameTimeline() { return frameTimeline; }
+    uint64_t getSubmittedFrame() { return submittedFrames; }
+    uint64_t getCompletedFrame() { return syncManager->getTimelineValue(frameTimeline); }
+    //CPU time the last frame spent resetting and recording its command buffer
+    double getLastRecordMs() { return lastRecordMs; }
+    //CPU time of the last frame from its start to its submit, including the wait for its slot, without limiter sleep or readback delivery outside the frame
+    double getLastFrameMs() { return lastFrameMs; }
+
+    //Takes effect on the next frame by recreating the swapchain, the mode actually used is reported by getPresentMode
+    void setPresentPolicy(const MYR::PresentPolicy& policy)
+    {
+        presentPolicy = policy;
+        presentPolicyChanged = true;
+    }
+    VkPresentModeKHR getPresentMode() { return swapChain->getPresentMode(); }
+
+    //Call before initComponents, falls back to the render pass when the device lacks dynamic rendering
+    void enableDynamicRendering() { useDynamicRendering = true; }
+    //Call before initComponents, frame and pass GPU times show up in getGpuProfiler()->getStats() a few frames later
+    void enableGpuProfiler() { useGpuProfiler = true; }
+    MYR::GpuProfiler getGpuProfiler() { return useGpuProfiler ? gpuProfiler.get() : nullptr; }
+
+    //Call before initComponents, frames go to offscreen images of the size given to the constructor, no GLFW, surface or swapchain is created
+    void enableHeadless() { useHeadless = true; }
+    bool isHeadless() { return useHeadless; }
+    //Call before initComponents, pins the physical device by enumeration index or part of its name, MYR_DEVICE in the environment wins
+    void setDevice(const std::string& deviceOverride) { device->setDeviceOverride(deviceOverride); }
+    const MYR::DeviceCapabilities& getDeviceCapabilities() { return device->getCapabilities(); }
+    //Headless only, receives each frame as tightly packed RGBA8 once its slot comes around again, the rest when the run loop returns
+    void setFrameReadback(std::function<void(const void* pixels, VkExtent2D extent, uint64_t frame)> callback) { frameReadback = std::move(callback); }
+
+#ifdef MYR_RUNTIME_SHADERS
+    //Call before initComponents, compiled SPIR-V is cached in shaderCacheDirectory
+    void useShaderSources(const std::string& vertPath, const std::string& fragPath, bool hotReload, const std::string& shaderCacheDirectory = "shader_cache")
     {
-        pipeline->addPushConstant(p);
+        if (!shaderCompiler)
+            shaderCompiler = std::make_unique<MYR::ShaderCompiler_T>(shaderCacheDirectory);
+        pipeline->setShaderSources(shaderCompiler.get(), { vertPath, VK_SHADER_STAGE_VERTEX_BIT }, { fragPath, VK_SHADER_STAGE_FRAGMENT_BIT }, hotReload);
     }
+#endif
 
     std::unique_ptr<Camera> camera;
-    Control* control;
+    Control* control{ nullptr };
+    MYR::PipelineState pipelineState{}; //variants are created on first use and cached by Pipeline_T
 private:
 
     std::unique_ptr<MYR::Window_T> window;
@@ -110,32 +223,83 @@ private:
     std::unique_ptr<MYR::Pipeline_T> pipeline;
     std::unique_ptr<MYR::Command_T> command;
     std::unique_ptr<MYR::SyncManager_T> syncManager;
+    std::unique_ptr<MYR::DeletionQueue_T> deletionQueue;
     std::unique_ptr<MYR::ImageManager_T> imageManager;
     std::unique_ptr<MYR::BufferManager_T> bufferManager;
     std::unique_ptr<MYR::Buffers_T> buffers;
+    std::unique_ptr<MYR::DescriptorLayoutCache_T> descriptorLayoutCache;
+    std::unique_ptr<MYR::DescriptorAllocator_T> descriptorAllocator;
+    std::unique_ptr<MYR::BindlessSet_T> bindlessSet;
+    std::unique_ptr<MYR::GpuProfiler_T> gpuProfiler;
+#ifdef MYR_RUNTIME_SHADERS
+    std::unique_ptr<MYR::ShaderCompiler_T> shaderCompiler;
+#endif
 
 
     std::vector<VkSemaphore> imageAvailableSemaphores;
-    std::vector<VkSemaphore> renderFinishedSemaphores;
-    std::vector<VkFence> inFlightFences;
+    std::vector<VkSemaphore> renderFinishedSemaphores; //one per swapchain image, present may hold it past the frame's slot
+    VkSemaphore frameTimeline{ VK_NULL_HANDLE }; //signaled with the frame value by every frame submission
 
     uint32_t currentFrame = 0;
+    uint32_t framesInFlight{ 2 };
+    uint32_t pendingFramesInFlight{ 2 };
+    uint64_t submittedFrames{ 0 };
+    uint64_t completedFrames{ 0 };
+    std::vector<uint64_t> slotFrameValues; //value of the last frame submitted from each slot
+    double lastRecordMs{ 0 };
+    double lastFrameMs{ 0 };
+    MYR::FrameLimiter frameLimiter;
     bool drawing{ true };
 
+    const std::chrono::milliseconds RESIZE_DEBOUNCE{ 50 };
+    std::chrono::steady_clock::time_point lastResizeEvent{};
+    bool resizePending{ false };
+    MYR::PresentPolicy presentPolicy{};
+    bool presentPolicyChanged{ false };
+    bool useBindless{ false };
+    bool useDynamicRendering{ false };
+    bool useGpuProfiler{ false };
+    bool useHeadless{ false };
+    bool closeRequested{ false };
+
+    //one host-visible copy of the offscreen image per frame slot
+    struct Readback
+    {
+        VkBuffer buffer{ VK_NULL_HANDLE };
+        void* mapped{ nullptr };
+        uint64_t frameValue{ 0 }; //frame waiting to be handed out, 0 when there is none
+    };
+    std::vector<Readback> readbacks;
+    std::function<void(const void*, VkExtent2D, uint64_t)> frameReadback;
+
 
     void cleanup()
     {
         vkDeviceWaitIdle(device->getHandle());
 
+#ifdef MYR_RUNTIME_SHADERS
+        shaderCompiler.reset();
+#endif
         swapChain.reset();
+        //the device is idle, so everything destroyed from here on goes immediately instead of into a queue that is about to die
+        imageManager->setDeletionQueue(nullptr);
+        bufferManager->setDeletionQueue(nullptr);
+        pipeline->setDeletionQueue(nullptr);
+        descriptorAllocator->setDeletionQueue(nullptr);
+        command->set_deletionQueue(nullptr);
+        deletionQueue.reset(); //runs whatever is left, including the depth image pushed by the swapchain above
         Control::destroyControl();
         camera.reset();
         imageManager.reset();
         bufferManager.reset();
         syncManager.reset();
         buffers.reset();
+        descriptorAllocator.reset();
         command.reset();
         pipeline.reset();
+        bindlessSet.reset();
+        gpuProfiler.reset();
+        descriptorLayoutCache.reset();
         device.reset();
         core.reset();
         window.reset();
@@ -143,33 +307,72 @@ private:
 
     void initVulkan()
     {
+        imageManager->setDeletionQueue(deletionQueue.get());
+        imageManager->setSyncManager(syncManager.get());
+        command->set_syncManager(syncManager.get());
+        command->set_deletionQueue(deletionQueue.get());
+        bufferManager->setDeletionQueue(deletionQueue.get());
+        pipeline->setDeletionQueue(deletionQueue.get());
+        descriptorAllocator->setDeletionQueue(deletionQueue.get());
+        bufferManager->setDescriptorAllocator(descriptorAllocator.get());
+        imageManager->setDescriptorAllocator(descriptorAllocator.get());
+
+        core->setHeadless(useHeadless);
         core->initVulkanInstance();
         core->initDebugMessenger();
-        core->initSurface(window.get());
-
-        device->setSurface(core->getSurface());
+        if (!useHeadless)
+        {
+            core->initSurface(window.get());
+            device->setSurface(core->getSurface());
+        }
 
         device->pickPhysicalDevice(core->getInstance());
         device->initLogicalDevice(enableValidationLayers);
         device->initAllocator(core->getInstance());
 
-        swapChain->initSwapChain(core->getSurface(), window->getHandle());
+        //offscreen images are tied to frame slots, so there is one per slot
+        if (useHeadless)
+            swapChain->initOffscreen({ window->getWidth(), window->getHeight() }, VK_FORMAT_R8G8B8A8_SRGB, MAX_FRAMES_IN_FLIGHT, imageManager.get());
+        else
+        {
+            swapChain->setPresentPolicy(presentPolicy);
+            swapChain->initSwapChain(core->getSurface(), window->getHandle());
+        }
+        presentPolicyChanged = false;
         swapChain->initImageViews();
 
-        pipeline->initRenderPass(swapChain->getImageFormat());
-        pipeline->initDescriptorSetLayout();
+        if (useBindless)
+        {
+            bindlessSet->init();
+            pipeline->setBindlessSet(bindlessSet.get());
+            buffers->setBindlessSet(bindlessSet.get());
+        }
+
+        useDynamicRendering = useDynamicRendering && device->supportsDynamicRendering();
+        if (useDynamicRendering)
+            pipeline->initRenderingFormats(swapChain->getImageFormat(), device->findDepthFormat());
+        else
+            pipeline->initRenderPass(swapChain->getImageFormat(), useHeadless ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        pipeline->initDescriptorSetLayout(descriptorLayoutCache.get());
         pipeline->initGraphicsPipeline();
 
 
+        if (useGpuProfiler)
+        {
+            gpuProfiler->init();
+            command->set_gpuProfiler(gpuProfiler.get());
+        }
+
         command->initCommandPool();
         command->initCommandBuffers();
 
         swapChain->initDepthStencil(imageManager.get());
-        swapChain->initFramebuffers(pipeline->getRenderPass());
+        if (!useDynamicRendering)
+            swapChain->initFramebuffers(pipeline->getRenderPass());
 
-        buffers->initDescriptorPool();
+        descriptorAllocator->setPoolSizes(pipeline->getDescriptorPoolSizes(1));
         buffers->initUniformBuffers(bufferManager.get(), sizeof(UniformBufferObject));
-        buffers->initDescriptorSets();
+        buffers->initDescriptorSets(descriptorAllocator.get());
 
         createSyncObjects();
     }
@@ -178,63 +381,136 @@ private:
     void createSyncObjects()
     {
         imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+        slotFrameValues.resize(MAX_FRAMES_IN_FLIGHT, 0);
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
-            imageAvailableSemaphores[i] = syncManager->createSemaphore();
-            renderFinishedSemaphores[i] = syncManager->createSemaphore();
-            inFlightFences[i] = syncManager->createFence();
+            imageAvailableSemaphores[i] = syncManager->acquireSemaphore();
         }
+        acquirePresentSemaphores();
+        frameTimeline = syncManager->createTimelineSemaphore(0);
     }
 
-    void doFrame()
+    void acquirePresentSemaphores()
     {
-        vkWaitForFences(device->getHandle(), 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+        renderFinishedSemaphores.resize(swapChain->getImageCount());
+        for (VkSemaphore& semaphore : renderFinishedSemaphores)
+            semaphore = syncManager->acquireSemaphore();
+    }
 
-        uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(device->getHandle(), swapChain->getHandle(), UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    void doFrame()
+    {
+        MYR_PROFILE_FUNCTION();
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        pipeline->reloadShaders();
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR)
+        //resize events arrive in bursts while the window is dragged, the swapchain is rebuilt once they settle
+        if (window->windowResized)
+        {
+            window->windowResized = false;
+            requestResize();
+        }
+        if (!useHeadless && (!drawing || presentPolicyChanged || (resizePending && std::chrono::steady_clock::now() - lastResizeEvent >= RESIZE_DEBOUNCE)))
         {
             recreateSwapChain();
-            return;
+            if (!drawing) return; //minimized, nothing to present to
         }
-        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
-            throw std::runtime_error("failed to acquire swap chain image!");
 
+        //every slot keeps its own command buffer and uniforms, so switching depth only changes which slot comes next
+        if (pendingFramesInFlight != framesInFlight)
+        {
+            framesInFlight = pendingFramesInFlight;
+            currentFrame %= framesInFlight;
+        }
 
-        vkResetFences(device->getHandle(), 1, &inFlightFences[currentFrame]);
+        //frame values start at 1, so a slot that was never used waits on 0 and returns at once
+        {
+            MYR_PROFILE_ZONE("WaitFrameTimeline");
+            syncManager->waitTimeline(frameTimeline, slotFrameValues[currentFrame]);
+        }
+        completedFrames = syncManager->getTimelineValue(frameTimeline);
+        deletionQueue->beginFrame(submittedFrames + 1, completedFrames);
+
+        //an offscreen image belongs to its slot, the wait above already made it free
+        uint32_t imageIndex = currentFrame;
+        if (useHeadless)
+            deliverReadback(currentFrame);
+        else
+        {
+            VkResult result;
+            {
+                MYR_PROFILE_ZONE("AcquireNextImage");
+                result = vkAcquireNextImageKHR(device->getHandle(), swapChain->getHandle(), UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+            }
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR)
+            {
+                recreateSwapChain();
+                return;
+            }
+            else if (result == VK_SUBOPTIMAL_KHR)
+                requestResize();
+            else if (result != VK_SUCCESS)
+                throw std::runtime_error("failed to acquire swap chain image!");
+        }
+
+
+        descriptorAllocator->resetFrame(currentFrame);
 
         updateUniformBuffer(currentFrame);
-        if (drawing) drawFrame(imageIndex);
+        drawFrame(imageIndex);
+        lastFrameMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
         
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        currentFrame = (currentFrame + 1) % framesInFlight;
     }
 
     void drawFrame(uint32_t imageIndex)
     {
-        vkResetCommandBuffer(*(command->refCommandfBuffer(currentFrame)), 0);
-        command->recordCommandBuffer(currentFrame, imageIndex, buffers->getVIBuffer(), buffers->getIndexCount(), buffers->getDiscriptorSets());
+        MYR_PROFILE_FUNCTION();
+        imageManager->flushUploads();
 
+        VkBuffer readbackBuffer = useHeadless && frameReadback ? getReadbackBuffer(currentFrame) : VK_NULL_HANDLE;
+        std::chrono::steady_clock::time_point recordStart = std::chrono::steady_clock::now();
+        vkResetCommandBuffer(*(command->refCommandfBuffer(currentFrame)), 0);
+        command->recordCommandBuffer(currentFrame, imageIndex, buffers->getVIBuffer(), buffers->getIndexCount(), buffers->getDiscriptorSets(), pipelineState, readbackBuffer);
+        lastRecordMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
 
-        std::vector<VkSemaphore> signalSemaphores = { renderFinishedSemaphores[currentFrame] };
-        command->submitCommandBuffer(currentFrame,imageIndex, imageAvailableSemaphores[currentFrame], signalSemaphores, inFlightFences[currentFrame]);
+        //offscreen frames neither wait for an acquire nor signal a present
+        std::vector<VkSemaphore> signalSemaphores;
+        VkSemaphore waitSemaphore = VK_NULL_HANDLE;
+        if (!useHeadless)
+        {
+            signalSemaphores.push_back(renderFinishedSemaphores[imageIndex]);
+            waitSemaphore = imageAvailableSemaphores[currentFrame];
+        }
+        command->submitCommandBuffer(currentFrame,imageIndex, waitSemaphore, signalSemaphores, frameTimeline, submittedFrames + 1);
+        submittedFrames++;
+        slotFrameValues[currentFrame] = submittedFrames;
+        if (readbackBuffer != VK_NULL_HANDLE)
+            readbacks[currentFrame].frameValue = submittedFrames;
+        if (useHeadless)
+            return;
 
-        VkResult result{ swapChain->presentImage(imageIndex, signalSemaphores) };
+        VkResult result;
+        {
+            MYR_PROFILE_ZONE("Present");
+            result = swapChain->presentImage(imageIndex, signalSemaphores);
+        }
 
         if (result == VK_ERROR_OUT_OF_DATE_KHR)
         {
             recreateSwapChain();
             return;
         }
-        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+        else if (result == VK_SUBOPTIMAL_KHR)
+            requestResize();
+        else if (result != VK_SUCCESS)
             throw std::runtime_error("failed to acquire swap chain image!");
     }
 
     void updateUniformBuffer(uint32_t currentImage)
     {
+        MYR_PROFILE_FUNCTION();
         UniformBufferObject ubo{};
         ubo.model = ubo.model = glm::mat4(1.0f);
         ubo.view = camera->get_look_at();
@@ -244,6 +520,65 @@ private:
         buffers->updateUniformBuffer(currentImage, &ubo, sizeof(UniformBufferObject));
     }
 
+    void pollInput()
+    {
+        if (useHeadless)
+            return;
+        glfwPollEvents();
+        control->update_camera(camera.get(), 20, 5);
+    }
+
+    bool shouldClose() { return useHeadless ? closeRequested : glfwWindowShouldClose(window->getHandle()); }
+
+    VkBuffer getReadbackBuffer(uint32_t slot)
+    {
+        if (readbacks.empty())
+            readbacks.resize(MAX_FRAMES_IN_FLIGHT);
+
+        Readback& readback = readbacks[slot];
+        if (readback.buffer == VK_NULL_HANDLE)
+        {
+            VkExtent2D extent = swapChain->getExtent();
+            bufferManager->createBuffer(VkDeviceSize(extent.width) * extent.height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+                VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT, &readback.buffer);
+            bufferManager->mapMemory(readback.buffer, &readback.mapped);
+        }
+        return readback.buffer;
+    }
+
+    //only called once the frame that filled the slot has completed
+    void deliverReadback(uint32_t slot)
+    {
+        if (slot >= readbacks.size() || readbacks[slot].frameValue == 0)
+            return;
+
+        Readback& readback = readbacks[slot];
+        bufferManager->invalidate(readback.buffer);
+        frameReadback(readback.mapped, swapChain->getExtent(), readback.frameValue);
+        readback.frameValue = 0;
+    }
+
+    void drainReadbacks()
+    {
+        if (readbacks.empty())
+            return;
+
+        syncManager->waitTimeline(frameTimeline, submittedFrames);
+        std::vector<uint32_t> slots;
+        for (uint32_t slot = 0; slot < readbacks.size(); slot++)
+            slots.push_back(slot);
+        std::sort(slots.begin(), slots.end(), [this](uint32_t a, uint32_t b) { return readbacks[a].frameValue < readbacks[b].frameValue; });
+        for (uint32_t slot : slots)
+            deliverReadback(slot);
+    }
+
+    void requestResize()
+    {
+        //a suboptimal swapchain can still present, so it waits for the debounce like a resize event
+        resizePending = true;
+        lastResizeEvent = std::chrono::steady_clock::now();
+    }
+
     void recreateSwapChain()
     {
         int width = 0, height = 0;
@@ -253,15 +588,30 @@ private:
         else
         {
             drawing = true;
-            vkDeviceWaitIdle(device->getHandle());
-
-            swapChain = std::make_unique<MYR::SwapChain_T>(MYR::SwapChain_T(device.get()));
+            resizePending = false;
+            presentPolicyChanged = false;
+
+            //the old swapchain is passed as oldSwapchain and kept alive until the frames that used it have finished, no idle wait
+            std::unique_ptr<MYR::SwapChain_T> newSwapChain = std::make_unique<MYR::SwapChain_T>(device.get());
+            newSwapChain->setPresentPolicy(presentPolicy);
+            newSwapChain->initSwapChain(core->getSurface(), window->getHandle(), swapChain->getHandle());
+            newSwapChain->initImageViews();
+            newSwapChain->initDepthStencil(imageManager.get());
+            if (!useDynamicRendering)
+                newSwapChain->initFramebuffers(pipeline->getRenderPass());
+
+            //the present semaphores go back to the pool together with the swapchain they were presented to
+            MYR::SwapChain_T* retired = swapChain.release();
+            MYR::SyncManager_T* sync = syncManager.get();
+            deletionQueue->push([retired, sync, semaphores = std::move(renderFinishedSemaphores)]()
+            {
+                delete retired;
+                for (VkSemaphore semaphore : semaphores)
+                    sync->releaseSemaphore(semaphore);
+            });
+            swapChain = std::move(newSwapChain);
             command->set_swapChain(swapChain.get());
-
-            swapChain->initSwapChain(core->getSurface(), window->getHandle());
-            swapChain->initImageViews();
-            swapChain->initDepthStencil(imageManager.get());
-            swapChain->initFramebuffers(pipeline->getRenderPass());
+            acquirePresentSemaphores();
         }
 
     }
@@ -0,0 +1,271 @@
+#include "BaseApp.h"
+#include <fstream>
+#include <iomanip>
+#include <cmath>
+
+//Headless benchmark, runs on any Vulkan implementation including lavapipe (pin it with --device llvmpipe or MYR_DEVICE=llvmpipe)
+//Bench [--min-vertices N] [--max-vertices N] [--iterations N] [--frames N] [--warmup N] [--device NAME|INDEX] [--output PATH]
+
+namespace
+{
+    struct Options
+    {
+        uint64_t minVertices{ 1000 };
+        uint64_t maxVertices{ 10000000 };
+        uint32_t iterations{ 10 }; //mesh uploads per size
+        uint32_t frames{ 200 }; //timed frames per size and frames-in-flight depth
+        uint32_t warmup{ 20 };
+        uint32_t width{ 1280 };
+        uint32_t height{ 720 };
+        std::string device;
+        std::string output{ "bench_results.json" };
+    };
+
+    struct Stats
+    {
+        double mean{ 0 };
+        double p50{ 0 };
+        double p99{ 0 };
+        double stddev{ 0 };
+        double min{ 0 };
+        double max{ 0 };
+        size_t samples{ 0 };
+    };
+
+    struct Result
+    {
+        std::string benchmark;
+        std::string unit;
+        uint64_t vertices;
+        uint32_t framesInFlight; //0 when the benchmark does not render
+        Stats stats;
+    };
+
+    Options parseArguments(int argc, char** argv)
+    {
+        Options options;
+        for (int i = 1; i < argc; i++)
+        {
+            std::string argument = argv[i];
+            if (i + 1 >= argc)
+                throw std::runtime_error("failed to parse " + argument + ", it needs a value!");
+            std::string value = argv[++i];
+
+            if (argument == "--min-vertices") options.minVertices = std::stoull(value);
+            else if (argument == "--max-vertices") options.maxVertices = std::stoull(value);
+            else if (argument == "--iterations") options.iterations = std::stoul(value);
+            else if (argument == "--frames") options.frames = std::stoul(value);
+            else if (argument == "--warmup") options.warmup = std::stoul(value);
+            else if (argument == "--width") options.width = std::stoul(value);
+            else if (argument == "--height") options.height = std::stoul(value);
+            else if (argument == "--device") options.device = value;
+            else if (argument == "--output") options.output = value;
+            else throw std::runtime_error("failed to parse unknown argument " + argument + "!");
+        }
+        if (options.minVertices < 4 || options.minVertices > options.maxVertices || options.iterations == 0 || options.frames == 0)
+            throw std::runtime_error("failed to parse arguments, the sweep is empty!");
+        return options;
+    }
+
+    //percentiles use the nearest rank, so p99 of 100 samples is the 99th smallest
+    Stats summarize(std::vector<double> samples)
+    {
+        Stats stats;
+        stats.samples = samples.size();
+        if (samples.empty())
+            return stats;
+
+        std::sort(samples.begin(), samples.end());
+        auto percentile = [&samples](double p)
+        {
+            size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samples.size()));
+            return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+        };
+        stats.p50 = percentile(50);
+        stats.p99 = percentile(99);
+        stats.min = samples.front();
+        stats.max = samples.back();
+
+        double sum = 0;
+        for (double sample : samples)
+            sum += sample;
+        stats.mean = sum / samples.size();
+
+        double squares = 0;
+        for (double sample : samples)
+            squares += (sample - stats.mean) * (sample - stats.mean);
+        stats.stddev = std::sqrt(squares / samples.size());
+        return stats;
+    }
+
+    //a flat grid of exactly count vertices, two triangles per complete cell
+    void buildGrid(uint64_t count, std::vector<MYR::Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        uint64_t columns = static_cast<uint64_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+        uint64_t rows = (count + columns - 1) / columns;
+
+        vertices.resize(count);
+        for (uint64_t i = 0; i < count; i++)
+        {
+            float x = static_cast<float>(i % columns) / (columns - 1) * 2.0f - 1.0f;
+            float y = static_cast<float>(i / columns) / std::max<uint64_t>(rows - 1, 1) * 2.0f - 1.0f;
+            vertices[i] = { { x, y, 0.0f }, { (x + 1.0f) * 0.5f, (y + 1.0f) * 0.5f, 1.0f } };
+        }
+
+        indices.clear();
+        indices.reserve(count * 6);
+        for (uint64_t row = 0; row + 1 < rows; row++)
+            for (uint64_t column = 0; column + 1 < columns; column++)
+            {
+                uint64_t topLeft = row * columns + column;
+                uint64_t bottomLeft = topLeft + columns;
+                if (bottomLeft + 1 >= count)
+                    break;
+                uint32_t quad[] = { uint32_t(topLeft), uint32_t(bottomLeft), uint32_t(topLeft + 1), uint32_t(topLeft + 1), uint32_t(bottomLeft), uint32_t(bottomLeft + 1) };
+                indices.insert(indices.end(), std::begin(quad), std::end(quad));
+            }
+    }
+
+    double elapsedMs(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const char* deviceTypeName(VkPhysicalDeviceType type)
+    {
+        switch (type)
+        {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+        case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+        default: return "other";
+        }
+    }
+
+    std::string escapeJson(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    void writeJson(const std::string& path, const Options& options, const MYR::DeviceCapabilities& capabilities, const std::vector<Result>& results)
+    {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open())
+            throw std::runtime_error("failed to open results file " + path + "!");
+
+        file << std::setprecision(6);
+        file << "{\n  \"device\": {\"name\": \"" << escapeJson(capabilities.name) << "\", \"type\": \"" << deviceTypeName(capabilities.type)
+            << "\", \"apiVersion\": \"" << VK_API_VERSION_MAJOR(capabilities.apiVersion) << "." << VK_API_VERSION_MINOR(capabilities.apiVersion)
+            << "." << VK_API_VERSION_PATCH(capabilities.apiVersion) << "\"},\n";
+        file << "  \"config\": {\"iterations\": " << options.iterations << ", \"frames\": " << options.frames << ", \"warmup\": " << options.warmup
+            << ", \"width\": " << options.width << ", \"height\": " << options.height << ", \"validation\": " << (enableValidationLayers ? "true" : "false") << "},\n";
+        file << "  \"results\": [";
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result& result = results[i];
+            file << (i == 0 ? "\n" : ",\n") << "    {\"benchmark\": \"" << result.benchmark << "\", \"unit\": \"" << result.unit << "\", \"vertices\": " << result.vertices;
+            if (result.framesInFlight != 0)
+                file << ", \"framesInFlight\": " << result.framesInFlight;
+            file << ", \"samples\": " << result.stats.samples << ", \"mean\": " << result.stats.mean << ", \"p50\": " << result.stats.p50
+                << ", \"p99\": " << result.stats.p99 << ", \"stddev\": " << result.stats.stddev << ", \"min\": " << result.stats.min
+                << ", \"max\": " << result.stats.max << "}";
+        }
+        file << "\n  ]\n}\n";
+    }
+
+    void report(std::vector<Result>& results, Result result)
+    {
+        std::cout << std::left << std::setw(22) << result.benchmark << std::right << std::setw(10) << result.vertices << " vertices";
+        if (result.framesInFlight != 0)
+            std::cout << "  depth " << result.framesInFlight;
+        std::cout << std::fixed << std::setprecision(3) << "  mean " << result.stats.mean << "  p50 " << result.stats.p50 << "  p99 " << result.stats.p99
+            << "  stddev " << result.stats.stddev << " " << result.unit << std::endl;
+        results.push_back(std::move(result));
+    }
+
+    void runSweep(const Options& options)
+    {
+        BaseApp app{ options.width, options.height };
+        app.enableHeadless();
+        if (!options.device.empty())
+            app.setDevice(options.device);
+        //shader.frag reads a vec4 push constant, the pipeline layout needs its range as in Example.cpp
+        glm::vec4 pushConstantValues{ 0.1f, 0.1f, 0.9f, 1.0f };
+        app.createPushConstant(MYR::PushConstant{ 0, 16, &pushConstantValues, VK_SHADER_STAGE_FRAGMENT_BIT });
+        app.initComponents();
+        std::cout << "device: " << app.getDeviceCapabilities().name << " (" << deviceTypeName(app.getDeviceCapabilities().type) << ")" << std::endl;
+        if (enableValidationLayers)
+            std::cout << "warning: validation layers are enabled, use a release build for meaningful numbers" << std::endl;
+
+        std::vector<Result> results;
+        for (uint64_t count = options.minVertices; count <= options.maxVertices; count *= 10)
+        {
+            buildGrid(count, app.vertices, app.indices);
+            double bytes = static_cast<double>(app.vertices.size() * sizeof(MYR::Vertex) + app.indices.size() * sizeof(uint32_t));
+
+            //flush_mesh_update is createVIBuffer plus retiring the old buffer, its staging copies wait for the transfer to finish
+            std::vector<double> flushMs;
+            std::vector<double> bandwidth;
+            for (uint32_t i = 0; i < options.iterations; i++)
+            {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                app.flush_mesh_update();
+                double ms = elapsedMs(start);
+                flushMs.push_back(ms);
+                bandwidth.push_back(bytes / (ms / 1000.0) / 1e9);
+
+                //retired buffers and staging memory are only freed once frames complete past them
+                app.runFrames(app.MAX_FRAMES_IN_FLIGHT + 1);
+            }
+            report(results, { "flush_mesh_update", "ms", count, 0, summarize(flushMs) });
+            report(results, { "upload_bandwidth", "GB/s", count, 0, summarize(bandwidth) });
+
+            std::vector<double> recordMs;
+            for (uint32_t depth = 1; depth <= static_cast<uint32_t>(app.MAX_FRAMES_IN_FLIGHT); depth++)
+            {
+                app.setFramesInFlight(depth);
+                app.runFrames(options.warmup + 1); //the first frame switches the depth
+
+                //timed inside doFrame, so the loop, limiter and readback delivery around it stay out of the numbers
+                std::vector<double> frameMs;
+                for (uint32_t i = 0; i < options.frames; i++)
+                {
+                    app.runFrames(1);
+                    frameMs.push_back(app.getLastFrameMs());
+                    recordMs.push_back(app.getLastRecordMs());
+                }
+                report(results, { "frame_time", "ms", count, depth, summarize(frameMs) });
+            }
+            report(results, { "record_command_buffer", "ms", count, 0, summarize(recordMs) });
+
+            if (count > options.maxVertices / 10)
+                break;
+        }
+
+        writeJson(options.output, options, app.getDeviceCapabilities(), results);
+        std::cout << "results written to " << options.output << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    try
+    {
+        runSweep(parseArguments(argc, argv));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
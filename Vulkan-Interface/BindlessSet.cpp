@@ -0,0 +1,157 @@
+#include "MYR.h"
+#include <algorithm>
+
+using namespace MYR;
+
+BindlessSet_T::BindlessSet_T(Device device, uint32_t maxBuffers, uint32_t maxImages, uint32_t maxSamplers) : device(device)
+{
+    buffers.capacity = maxBuffers;
+    images.capacity = maxImages;
+    samplers.capacity = maxSamplers;
+}
+
+BindlessSet_T::~BindlessSet_T()
+{
+    vkDestroyDescriptorPool(device->getHandle(), descriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(device->getHandle(), descriptorSetLayout, nullptr);
+}
+
+void BindlessSet_T::init()
+{
+    if (!device->supportsDescriptorIndexing())
+        throw std::runtime_error("failed to create bindless set: descriptor indexing is not supported!");
+
+    //clamp the requested table sizes to what update-after-bind sets may hold on this device
+    VkPhysicalDeviceVulkan12Properties properties12{};
+    properties12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &properties12;
+    vkGetPhysicalDeviceProperties2(device->getPhysicalDevice(), &properties);
+
+    buffers.capacity = std::min({ buffers.capacity, properties12.maxDescriptorSetUpdateAfterBindStorageBuffers, properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+    images.capacity = std::min({ images.capacity, properties12.maxDescriptorSetUpdateAfterBindSampledImages, properties12.maxPerStageDescriptorUpdateAfterBindSampledImages });
+    samplers.capacity = std::min({ samplers.capacity, properties12.maxDescriptorSetUpdateAfterBindSamplers, properties12.maxPerStageDescriptorUpdateAfterBindSamplers });
+
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    bindings[0] = { STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers.capacity, VK_SHADER_STAGE_ALL, nullptr };
+    bindings[1] = { SAMPLED_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, images.capacity, VK_SHADER_STAGE_ALL, nullptr };
+    bindings[2] = { SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER, samplers.capacity, VK_SHADER_STAGE_ALL, nullptr };
+
+    //slots may stay empty, and may be written while earlier frames using other slots are still executing
+    VkDescriptorBindingFlags flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    std::array<VkDescriptorBindingFlags, 3> bindingFlags{ flags, flags, flags };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = bindingFlags.data();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device->getHandle(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create bindless descriptor set layout!");
+
+    std::array<VkDescriptorPoolSize, 3> poolSizes
+    {{
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers.capacity },
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, images.capacity },
+        { VK_DESCRIPTOR_TYPE_SAMPLER, samplers.capacity }
+    }};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1;
+
+    if (vkCreateDescriptorPool(device->getHandle(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create bindless descriptor pool!");
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(device->getHandle(), &allocInfo, &descriptorSet) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate bindless descriptor set!");
+}
+
+uint32_t BindlessSet_T::addBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    uint32_t index = buffers.acquire();
+    setBuffer(index, buffer, offset, range);
+    return index;
+}
+
+uint32_t BindlessSet_T::addImage(VkImageView imageView, VkImageLayout imageLayout)
+{
+    uint32_t index = images.acquire();
+    setImage(index, imageView, imageLayout);
+    return index;
+}
+
+uint32_t BindlessSet_T::addSampler(VkSampler sampler)
+{
+    uint32_t index = samplers.acquire();
+    setSampler(index, sampler);
+    return index;
+}
+
+void BindlessSet_T::setBuffer(uint32_t index, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    VkDescriptorBufferInfo bufferInfo{ buffer, offset, range };
+    write(STORAGE_BUFFER_BINDING, index, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, &bufferInfo, nullptr);
+}
+
+void BindlessSet_T::setImage(uint32_t index, VkImageView imageView, VkImageLayout imageLayout)
+{
+    VkDescriptorImageInfo imageInfo{ VK_NULL_HANDLE, imageView, imageLayout };
+    write(SAMPLED_IMAGE_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, nullptr, &imageInfo);
+}
+
+void BindlessSet_T::setSampler(uint32_t index, VkSampler sampler)
+{
+    VkDescriptorImageInfo imageInfo{ sampler, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED };
+    write(SAMPLER_BINDING, index, VK_DESCRIPTOR_TYPE_SAMPLER, nullptr, &imageInfo);
+}
+
+void BindlessSet_T::write(uint32_t binding, uint32_t index, VkDescriptorType type, const VkDescriptorBufferInfo* bufferInfo, const VkDescriptorImageInfo* imageInfo)
+{
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = binding;
+    descriptorWrite.dstArrayElement = index;
+    descriptorWrite.descriptorType = type;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = bufferInfo;
+    descriptorWrite.pImageInfo = imageInfo;
+
+    vkUpdateDescriptorSets(device->getHandle(), 1, &descriptorWrite, 0, nullptr);
+}
+
+uint32_t BindlessSet_T::Slots::acquire()
+{
+    if (!freeList.empty())
+    {
+        uint32_t index = freeList.back();
+        freeList.pop_back();
+        return index;
+    }
+    if (next == capacity)
+        throw std::runtime_error("bindless descriptor table is full!");
+    return next++;
+}
+
+void BindlessSet_T::Slots::release(uint32_t index)
+{
+    freeList.push_back(index);
+}
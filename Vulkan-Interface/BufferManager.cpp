@@ -34,8 +34,16 @@ void BufferManager_T::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
 
 void BufferManager_T::destroyBuffer(VkBuffer buffer)
 {
-    vmaDestroyBuffer(device->getAllocator(), buffer, allocations[buffer]);
+    //frames still in flight may read it, the queue holds it until they are done
+    VmaAllocator allocator = device->getAllocator();
+    VmaAllocation allocation = allocations[buffer];
     allocations.erase(buffer);
+    if (descriptorAllocator != nullptr)
+        descriptorAllocator->releaseBuffer(buffer); //the handle value can come back for a new buffer
+    if (deletionQueue != nullptr)
+        deletionQueue->push([allocator, buffer, allocation]() { vmaDestroyBuffer(allocator, buffer, allocation); });
+    else
+        vmaDestroyBuffer(allocator, buffer, allocation);
 }
 
 void BufferManager_T::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, uint32_t dst_offset, VkDeviceSize size)
@@ -61,4 +69,8 @@ void BufferManager_T::unmapMemory(VkBuffer buffer)
 {
     vmaUnmapMemory(device->getAllocator(), allocations[buffer]);
     mappedBuffers.erase(buffer);
+}
+void BufferManager_T::invalidate(VkBuffer buffer)
+{
+    vmaInvalidateAllocation(device->getAllocator(), allocations[buffer], 0, VK_WHOLE_SIZE);
 }
\ No newline at end of file
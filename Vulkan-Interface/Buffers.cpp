@@ -3,10 +3,7 @@
 using namespace MYR;
 
 Buffers_T::Buffers_T(Device device, Pipeline pipeline,Command command, const int MAX_FRAMES_IN_FLIGHT) : device(device), pipeline(pipeline), MAX_FRAMES_IN_FLIGHT(MAX_FRAMES_IN_FLIGHT), command(command){}
-Buffers_T::~Buffers_T()
-{
-    vkDestroyDescriptorPool(device->getHandle(), descriptorPool, nullptr);
-}
+Buffers_T::~Buffers_T() {}
 
 void Buffers_T::createVIBuffer(BufferManager bufferManager,const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
 {
@@ -19,7 +16,10 @@ void Buffers_T::createVIBuffer(BufferManager bufferManager,const std::vector<Ver
 
     VkBuffer stagingBuffer;
 
-    bufferManager->createBuffer(viBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, static_cast<VmaAllocationCreateFlagBits>(0), &viBuffer);
+    VkBufferUsageFlags viUsage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    if (bindlessSet != nullptr)
+        viUsage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT; //lets shaders pull vertices through the bindless table
+    bufferManager->createBuffer(viBufferSize, viUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, static_cast<VmaAllocationCreateFlagBits>(0), &viBuffer);
 
 
     bufferManager->createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT, &stagingBuffer);
@@ -37,6 +37,10 @@ void Buffers_T::createVIBuffer(BufferManager bufferManager,const std::vector<Ver
     bufferManager->unmapMemory(stagingBuffer);
     bufferManager->copyBuffer(stagingBuffer, viBuffer,sizeof(indices[0])*index_count, vertexBufferSize);
     bufferManager->destroyBuffer(stagingBuffer);
+
+    //a rebuilt mesh takes a fresh slot, rewriting the old one would race the frames still reading it, so re-query getVIBufferIndex
+    if (bindlessSet != nullptr)
+        viBufferIndex = bindlessSet->addBuffer(viBuffer);
 }
 
 void Buffers_T::initUniformBuffers(BufferManager bufferManager,size_t uboSize)
@@ -50,58 +54,14 @@ void Buffers_T::initUniformBuffers(BufferManager bufferManager,size_t uboSize)
     }
 }
 
-void Buffers_T::initDescriptorPool()
+void Buffers_T::initDescriptorSets(DescriptorAllocator descriptorAllocator)
 {
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes = &poolSize;
-
-    poolInfo.maxSets = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-
-    if (vkCreateDescriptorPool(device->getHandle(), &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
-        throw std::runtime_error("failed to create descriptor pool!");
-    
-}
-
-void Buffers_T::initDescriptorSets()
-{
-    std::vector<VkDescriptorSetLayout> layouts(MAX_FRAMES_IN_FLIGHT, pipeline->getDescriptorLayout());
-    VkDescriptorSetAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo.descriptorPool = descriptorPool;
-    allocInfo.descriptorSetCount = static_cast<uint32_t>(MAX_FRAMES_IN_FLIGHT);
-    allocInfo.pSetLayouts = layouts.data();
-
     descriptorSets.resize(MAX_FRAMES_IN_FLIGHT);
-    if (vkAllocateDescriptorSets(device->getHandle(), &allocInfo, descriptorSets.data()) != VK_SUCCESS)
-        throw std::runtime_error("failed to allocate descriptor sets!");
-
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        std::vector<VkWriteDescriptorSet > descriptorWriters{ 1 };
-
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = uniformBuffers[i];
-        bufferInfo.offset = 0;
-        bufferInfo.range = VK_WHOLE_SIZE;
-
-        VkWriteDescriptorSet descriptorWrite{};
-        descriptorWriters[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWriters[0].dstSet = descriptorSets[i];
-        descriptorWriters[0].dstBinding = 0;
-        descriptorWriters[0].dstArrayElement = 0;
-        descriptorWriters[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWriters[0].descriptorCount = 1;
-        descriptorWriters[0].pBufferInfo = &bufferInfo;
-        descriptorWriters[0].pImageInfo = nullptr;
-        descriptorWriters[0].pTexelBufferView = nullptr;
-
-        vkUpdateDescriptorSets(device->getHandle(), (uint32_t) descriptorWriters.size(), descriptorWriters.data(), 0, nullptr);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    {
+        DescriptorBinding uboBinding{ 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER };
+        uboBinding.buffer = uniformBuffers[i];
+        descriptorSets[i] = descriptorAllocator->getSet(pipeline->getDescriptorLayout(), { uboBinding });
     }
-    
 }
 
@@ -3,12 +3,26 @@
 
 using namespace MYR;
 
+bool hasStencilComponent(VkFormat format);
+
+namespace
+{
+    std::array<VkClearValue, 2> attachmentClearValues()
+    {
+        std::array<VkClearValue, 2> clearValues{};
+        clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+        clearValues[1].depthStencil = { 1.0f, 0 };
+        return clearValues;
+    }
+}
+
 Command_T::Command_T(Device device, Pipeline pipeline, SwapChain swapChain, const int MAX_FRAMES_IN_FLIGHT) : device(device), pipeline(pipeline), MAX_FRAMES_IN_FLIGHT(MAX_FRAMES_IN_FLIGHT), swapChain(swapChain) {}
 
 Command_T::~Command_T()
 {
     vkDestroyCommandPool(device->getHandle(), commandPool, nullptr);
     vkDestroyCommandPool(device->getHandle(), transientCommandPool, nullptr);
+    delete frameGraph;
 }
 
 void Command_T::initCommandPool()
@@ -49,41 +63,133 @@ void Command_T::initCommandBuffers()
         throw std::runtime_error("failed to allocate command buffers!");
     }
 }
-void Command_T::recordCommandBuffer(uint32_t currentFrameIndex, uint32_t imageIndex, VkBuffer viBuffer,uint32_t index_count, std::vector<VkDescriptorSet> *descriptorSets)
+void Command_T::recordCommandBuffer(uint32_t currentFrameIndex, uint32_t imageIndex, VkBuffer viBuffer,uint32_t index_count, std::vector<VkDescriptorSet> *descriptorSets, const PipelineState& pipelineState, VkBuffer readbackBuffer)
 {
+    MYR_PROFILE_FUNCTION();
+    VkCommandBuffer commandBuffer = commandBuffers[currentFrameIndex];
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = 0; // Optional
     beginInfo.pInheritanceInfo = nullptr; // Optional
 
-    if (vkBeginCommandBuffer(commandBuffers[currentFrameIndex], &beginInfo) != VK_SUCCESS)
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to begin recording command buffer!");
     }
+    if (gpuProfiler != nullptr)
+        gpuProfiler->beginFrame(commandBuffer, currentFrameIndex);
+    beginGpuScope(commandBuffer, "Frame");
+
+    frame = { currentFrameIndex, imageIndex, viBuffer, index_count, descriptorSets, pipelineState, readbackBuffer };
+
+    //without a render pass nothing moves the attachments between layouts, the frame graph records those barriers
+    if (pipeline->usesDynamicRendering())
+    {
+        bool readback = readbackBuffer != VK_NULL_HANDLE;
+        if (!frameGraph || frameGraphReadback != readback || frameGraphOffscreen != swapChain->isOffscreen())
+            buildFrameGraph(readback);
+
+        frameGraph->setImage(colorTarget, swapChain->getImage(imageIndex), swapChain->getView(imageIndex));
+        frameGraph->setImage(depthTarget, swapChain->getDepthImage(), swapChain->getDepthView());
+        if (readback)
+            frameGraph->setBuffer(readbackTarget, readbackBuffer);
+        frameGraph->execute(commandBuffer);
+    }
+    else
+    {
+        std::array<VkClearValue, 2> clearValues = attachmentClearValues();
+
+        beginGpuScope(commandBuffer, "MainPass");
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = pipeline->getRenderPass();
+        renderPassInfo.framebuffer = swapChain->getFramebuffer(imageIndex);
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = swapChain->getExtent();
+        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+        renderPassInfo.pClearValues = clearValues.data();
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        recordDraw(commandBuffer);
+        vkCmdEndRenderPass(commandBuffer);
+        endGpuScope(commandBuffer);
+
+        //offscreen images end in TRANSFER_SRC, ready to be copied out
+        if (swapChain->isOffscreen())
+        {
+            BarrierBatch barriers(device);
+            barriers.transition(swapChain->getImage(imageIndex), VK_IMAGE_ASPECT_COLOR_BIT, ResourceState::ColorAttachment, ResourceState::TransferSrc);
+            barriers.flush(commandBuffer);
+
+            if (readbackBuffer != VK_NULL_HANDLE)
+            {
+                recordReadback(commandBuffer);
+                barriers.transition(readbackBuffer, ResourceState::TransferDst, ResourceState::HostRead);
+                barriers.flush(commandBuffer);
+            }
+        }
+    }
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = pipeline->getRenderPass();
-    renderPassInfo.framebuffer = swapChain->getFramebuffer(imageIndex);
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = swapChain->getExtent();
+    endGpuScope(commandBuffer);
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to record command buffer!");
 
-    std::array<VkClearValue, 2> clearValues{};
-    clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-    clearValues[1].depthStencil = { 1.0f, 0 };
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassInfo.pClearValues = clearValues.data();
+}
 
-    vkCmdBeginRenderPass(commandBuffers[currentFrameIndex], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+void Command_T::buildFrameGraph(bool readback)
+{
+    if (!frameGraph)
+        frameGraph = new RenderGraph_T(device);
+    frameGraph->reset();
+    frameGraph->setGpuProfiler(gpuProfiler);
+    frameGraph->setDeletionQueue(deletionQueue);
+
+    VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (hasStencilComponent(swapChain->getDepthFormat()))
+        depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+    //a swapchain image comes back at COLOR_ATTACHMENT_OUTPUT, the stage the acquire semaphore is waited on, offscreen images after their copy
+    bool offscreen = swapChain->isOffscreen();
+    colorTarget = frameGraph->importImage("Color", VK_IMAGE_ASPECT_COLOR_BIT, offscreen ? ResourceState::TransferSrc : ResourceState::ColorAttachment,
+        offscreen ? ResourceState::TransferSrc : ResourceState::Present);
+    depthTarget = frameGraph->importImage("Depth", depthAspect, ResourceState::DepthAttachment, ResourceState::DepthAttachment);
+    frameGraph->markOutput(colorTarget);
+
+    //both attachments are cleared, so they are only written and the graph discards their old contents
+    frameGraph->addPass("MainPass", [this](VkCommandBuffer commandBuffer, RenderGraph_T&)
+        {
+            beginDynamicRendering(commandBuffer, frame.imageIndex);
+            recordDraw(commandBuffer);
+            vkCmdEndRendering(commandBuffer);
+        })
+        .write(colorTarget, ResourceState::ColorAttachment)
+        .write(depthTarget, ResourceState::DepthAttachment);
+
+    if (readback)
+    {
+        readbackTarget = frameGraph->importBuffer("Readback", ResourceState::HostRead, ResourceState::HostRead);
+        frameGraph->addPass("Readback", [this](VkCommandBuffer commandBuffer, RenderGraph_T&) { recordReadback(commandBuffer); })
+            .read(colorTarget, ResourceState::TransferSrc)
+            .write(readbackTarget, ResourceState::TransferDst)
+            .sideEffects();
+    }
 
-    vkCmdBindPipeline(commandBuffers[currentFrameIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getHandle());
+    frameGraphReadback = readback;
+    frameGraphOffscreen = offscreen;
+}
 
-    VkBuffer vertexBuffers[] = { viBuffer };
-    VkDeviceSize offsets[] = { sizeof(uint32_t) * index_count };
-    vkCmdBindVertexBuffers(commandBuffers[currentFrameIndex], 0, 1, vertexBuffers, offsets);
+void Command_T::recordDraw(VkCommandBuffer commandBuffer)
+{
+    //a variant still compiling in the background resolves to the fallback pipeline, or to null when the draw should be skipped
+    VkPipeline graphicsPipeline = pipeline->requestPipeline(frame.pipelineState);
+    if (graphicsPipeline != VK_NULL_HANDLE)
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 
-    vkCmdBindIndexBuffer(commandBuffers[currentFrameIndex], viBuffer, 0, VK_INDEX_TYPE_UINT32);
+    VkBuffer vertexBuffers[] = { frame.viBuffer };
+    VkDeviceSize offsets[] = { sizeof(uint32_t) * frame.indexCount };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
 
+    vkCmdBindIndexBuffer(commandBuffer, frame.viBuffer, 0, VK_INDEX_TYPE_UINT32);
 
     VkViewport viewport{};
     viewport.x = 0.0f;
@@ -92,45 +198,148 @@ void Command_T::recordCommandBuffer(uint32_t currentFrameIndex, uint32_t imageIn
     viewport.height = static_cast<float>(swapChain->getExtent().height);
     viewport.minDepth = 0.0f;
     viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(commandBuffers[currentFrameIndex], 0, 1, &viewport);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
     VkRect2D scissor{};
     scissor.offset = { 0, 0 };
     scissor.extent = swapChain->getExtent();
-    vkCmdSetScissor(commandBuffers[currentFrameIndex], 0, 1, &scissor);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
 
-    vkCmdBindDescriptorSets(commandBuffers[currentFrameIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 1, &((*descriptorSets)[currentFrameIndex]), 0, nullptr);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), 0, 1, &((*frame.descriptorSets)[frame.frameIndex]), 0, nullptr);
 
-    for (PushConstant& pushConstant: pipeline->getPushConstants())
-        vkCmdPushConstants(commandBuffers[currentFrameIndex], pipeline->getPipelineLayout(), pushConstant.stages, pushConstant.offset, pushConstant.size, pushConstant.data);
+    //the bindless table is bound once per command buffer, draws select resources by index instead of rebinding sets
+    if (BindlessSet bindlessSet = pipeline->getBindlessSet())
+    {
+        VkDescriptorSet bindlessDescriptorSet = bindlessSet->getHandle();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(), BindlessSet_T::SET_INDEX, 1, &bindlessDescriptorSet, 0, nullptr);
+    }
 
-    vkCmdDrawIndexed(commandBuffers[currentFrameIndex], index_count, 1, 0, 0, 0);
+    //the command buffer was reset so everything is pushed, in as few calls as the stage layout allows
+    PushConstantBlock& pushConstants = pipeline->getPushConstantBlock();
+    pushConstants.flush(commandBuffer, pipeline->getPipelineLayout());
 
+    if (graphicsPipeline != VK_NULL_HANDLE)
+        vkCmdDrawIndexed(commandBuffer, frame.indexCount, 1, 0, 0, 0);
+}
 
-    vkCmdEndRenderPass(commandBuffers[currentFrameIndex]);
-    if (vkEndCommandBuffer(commandBuffers[currentFrameIndex]) != VK_SUCCESS)
-        throw std::runtime_error("failed to record command buffer!");
+void Command_T::recordReadback(VkCommandBuffer commandBuffer)
+{
+    VkBufferImageCopy region{};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { swapChain->getExtent().width, swapChain->getExtent().height, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, swapChain->getImage(frame.imageIndex), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, frame.readbackBuffer, 1, &region);
+}
 
+void Command_T::beginDynamicRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    std::array<VkClearValue, 2> clearValues = attachmentClearValues();
+
+    VkRenderingAttachmentInfo colorAttachment{};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    colorAttachment.imageView = swapChain->getView(imageIndex);
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.clearValue = clearValues[0];
+
+    VkRenderingAttachmentInfo depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depthAttachment.imageView = swapChain->getDepthView();
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue = clearValues[1];
+
+    VkRenderingInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderingInfo.renderArea.offset = { 0, 0 };
+    renderingInfo.renderArea.extent = swapChain->getExtent();
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+
+    vkCmdBeginRendering(commandBuffer, &renderingInfo);
 }
 
-void Command_T::submitCommandBuffer(uint32_t currentFrame, uint32_t imageIndex, VkSemaphore imageAvailableSemaphore, std::vector<VkSemaphore>& signalSemaphores, VkFence inFlightFence)
+void Command_T::submitCommandBuffer(uint32_t currentFrame, uint32_t imageIndex, VkSemaphore imageAvailableSemaphore, std::vector<VkSemaphore>& signalSemaphores, VkSemaphore timeline, uint64_t timelineValue)
 {
+    //the binary semaphores stay for the swapchain, the timeline is signaled with the frame value for everything else
+    if (device->supportsSynchronization2())
+    {
+        VkSemaphoreSubmitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        waitInfo.semaphore = imageAvailableSemaphore;
+        waitInfo.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+        std::vector<VkSemaphoreSubmitInfo> signalInfos(signalSemaphores.size() + 1);
+        for (size_t i = 0; i < signalSemaphores.size(); i++)
+        {
+            signalInfos[i].sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+            signalInfos[i].semaphore = signalSemaphores[i];
+            signalInfos[i].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        }
+        signalInfos.back().sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+        signalInfos.back().semaphore = timeline;
+        signalInfos.back().value = timelineValue;
+        signalInfos.back().stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+        VkCommandBufferSubmitInfo commandBufferInfo{};
+        commandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+        commandBufferInfo.commandBuffer = *refCommandfBuffer(currentFrame);
+
+        VkSubmitInfo2 submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+        submitInfo.waitSemaphoreInfoCount = imageAvailableSemaphore != VK_NULL_HANDLE ? 1 : 0; //offscreen frames have no acquire to wait for
+        submitInfo.pWaitSemaphoreInfos = &waitInfo;
+        submitInfo.commandBufferInfoCount = 1;
+        submitInfo.pCommandBufferInfos = &commandBufferInfo;
+        submitInfo.signalSemaphoreInfoCount = static_cast<uint32_t>(signalInfos.size());
+        submitInfo.pSignalSemaphoreInfos = signalInfos.data();
+        if (vkQueueSubmit2(device->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+            throw std::runtime_error("failed to submit draw command buffer!");
+        return;
+    }
+
+    std::vector<VkSemaphore> semaphores = signalSemaphores;
+    semaphores.push_back(timeline);
+    std::vector<uint64_t> signalValues(semaphores.size(), 0); //ignored for binary semaphores
+    signalValues.back() = timelineValue;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+    timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
     VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.waitSemaphoreCount = imageAvailableSemaphore != VK_NULL_HANDLE ? 1 : 0;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = refCommandfBuffer(currentFrame);
-    submitInfo.signalSemaphoreCount = signalSemaphores.size();
-    submitInfo.pSignalSemaphores = signalSemaphores.data();
-    if (vkQueueSubmit(device->getGraphicsQueue(), 1, &submitInfo, inFlightFence) != VK_SUCCESS)
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(semaphores.size());
+    submitInfo.pSignalSemaphores = semaphores.data();
+    if (vkQueueSubmit(device->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
         throw std::runtime_error("failed to submit draw command buffer!");
 }
 
+void Command_T::beginGpuScope(VkCommandBuffer commandBuffer, const std::string& name)
+{
+    if (gpuProfiler != nullptr)
+        gpuProfiler->beginScope(commandBuffer, name);
+}
+
+void Command_T::endGpuScope(VkCommandBuffer commandBuffer)
+{
+    if (gpuProfiler != nullptr)
+        gpuProfiler->endScope(commandBuffer);
+}
+
 VkCommandBuffer Command_T::beginSingleTimeCommands() {
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -158,8 +367,16 @@ void Command_T::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(device->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(device->getGraphicsQueue());
+    //with a sync manager only this submission is waited for, not everything else on the queue
+    VkFence fence = syncManager != nullptr ? syncManager->acquireFence() : VK_NULL_HANDLE;
+    vkQueueSubmit(device->getGraphicsQueue(), 1, &submitInfo, fence);
+    if (fence != VK_NULL_HANDLE)
+    {
+        vkWaitForFences(device->getHandle(), 1, &fence, VK_TRUE, UINT64_MAX);
+        syncManager->releaseFence(fence);
+    }
+    else
+        vkQueueWaitIdle(device->getGraphicsQueue());
 
     vkFreeCommandBuffers(device->getHandle(), transientCommandPool, 1, &commandBuffer);
 }
\ No newline at end of file
@@ -1,3 +1,3 @@
-C:\VulkanSDK\1.4.304.0\Bin\glslc.exe -o vert.spv shader.vert
-C:\VulkanSDK\1.4.304.0\Bin\glslc.exe -o frag.spv shader.frag
+C:\VulkanSDK\1.4.304.0\Bin\glslc.exe -mfmt=num -o vert.spv.inc shader.vert
+C:\VulkanSDK\1.4.304.0\Bin\glslc.exe -mfmt=num -o frag.spv.inc shader.frag
 pause
\ No newline at end of file
@@ -0,0 +1,3 @@
+#!/bin/sh
+glslc -mfmt=num -o vert.spv.inc shader.vert
+glslc -mfmt=num -o frag.spv.inc shader.frag
@@ -0,0 +1,78 @@
+#include "MYR.h"
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+
+using namespace MYR;
+
+std::deque<CpuProfiler::ThreadRing>& CpuProfiler::registry()
+{
+    static std::deque<ThreadRing> rings;
+    return rings;
+}
+
+std::mutex& CpuProfiler::registryMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+CpuProfiler::ThreadRing& CpuProfiler::threadRing()
+{
+    thread_local ThreadRing* ring = nullptr;
+    if (ring == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex());
+        ring = &registry().emplace_back();
+        ring->threadIndex = static_cast<uint32_t>(registry().size());
+    }
+    return *ring;
+}
+
+void CpuProfiler::record(const char* name, int64_t beginNs, int64_t endNs)
+{
+    ThreadRing& ring = threadRing();
+    uint64_t index = ring.written.load(std::memory_order_relaxed);
+    ring.zones[index % RING_SIZE] = { name, beginNs, endNs };
+    ring.written.store(index + 1, std::memory_order_release);
+}
+
+void CpuProfiler::writeChromeTrace(const std::string& path)
+{
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open trace file " + path + "!");
+
+    std::lock_guard<std::mutex> lock(registryMutex());
+    int64_t origin = INT64_MAX;
+    for (ThreadRing& ring : registry())
+    {
+        uint64_t written = ring.written.load(std::memory_order_acquire);
+        for (uint64_t i = written - std::min<uint64_t>(written, RING_SIZE); i < written; i++)
+            origin = std::min(origin, ring.zones[i % RING_SIZE].beginNs);
+    }
+
+    //same layout as GpuProfiler_T traces, pid 0 keeps CPU threads apart from the GPU track when both files are loaded
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\":[";
+    bool first = true;
+    for (ThreadRing& ring : registry())
+    {
+        file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << ring.threadIndex
+            << ",\"args\":{\"name\":\"CPU " << ring.threadIndex << "\"}}";
+        first = false;
+
+        uint64_t written = ring.written.load(std::memory_order_acquire);
+        for (uint64_t i = written - std::min<uint64_t>(written, RING_SIZE); i < written; i++)
+        {
+            const Zone& zone = ring.zones[i % RING_SIZE];
+            file << ",\n{\"name\":\"" << zone.name << "\",\"cat\":\"cpu\",\"pid\":0,\"tid\":" << ring.threadIndex
+                << ",\"ts\":" << (zone.beginNs - origin) / 1e3;
+            if (zone.endNs < 0)
+                file << ",\"ph\":\"i\",\"s\":\"p\"}";
+            else
+                file << ",\"ph\":\"X\",\"dur\":" << (zone.endNs - zone.beginNs) / 1e3 << "}";
+        }
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
@@ -0,0 +1,42 @@
+#include "MYR.h"
+
+using namespace MYR;
+
+DeletionQueue_T::DeletionQueue_T() {}
+DeletionQueue_T::~DeletionQueue_T()
+{
+    flush();
+}
+
+void DeletionQueue_T::push(std::function<void()> deleter)
+{
+    entries.push_back({ frameValue, std::move(deleter) });
+}
+
+void DeletionQueue_T::beginFrame(uint64_t frameValue, uint64_t completedValue)
+{
+    this->frameValue = frameValue;
+    collect(completedValue);
+}
+
+void DeletionQueue_T::collect(uint64_t completedValue)
+{
+    //entries are pushed in frame order, so the first one still in flight ends the scan
+    while (!entries.empty() && entries.front().first <= completedValue)
+    {
+        std::function<void()> deleter = std::move(entries.front().second);
+        entries.pop_front();
+        deleter();
+    }
+}
+
+void DeletionQueue_T::flush()
+{
+    //only once the device is idle, a deleter may push further entries which are run as well
+    while (!entries.empty())
+    {
+        std::function<void()> deleter = std::move(entries.front().second);
+        entries.pop_front();
+        deleter();
+    }
+}
@@ -0,0 +1,249 @@
+#include "MYR.h"
+#include <algorithm>
+
+using namespace MYR;
+
+namespace
+{
+    //descriptors per set, scaled by the number of sets a pool holds
+    const std::vector<VkDescriptorPoolSize> DEFAULT_POOL_SIZES
+    {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 },
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1 },
+        { VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 }
+    };
+}
+
+DescriptorAllocator_T::DescriptorAllocator_T(Device device, const int MAX_FRAMES_IN_FLIGHT) : device(device), poolSizes(DEFAULT_POOL_SIZES), frameChains(MAX_FRAMES_IN_FLIGHT) {}
+
+DescriptorAllocator_T::~DescriptorAllocator_T()
+{
+    for (VkDescriptorPool pool : persistentChain.pools)
+        vkDestroyDescriptorPool(device->getHandle(), pool, nullptr);
+
+    for (PoolChain& chain : frameChains)
+        for (VkDescriptorPool pool : chain.pools)
+            vkDestroyDescriptorPool(device->getHandle(), pool, nullptr);
+}
+
+void DescriptorAllocator_T::setPoolSizes(const std::vector<VkDescriptorPoolSize>& sizesPerSet)
+{
+    //reflected sizes come on top of the defaults, so sets of types the current shaders do not use can still be allocated
+    poolSizes = DEFAULT_POOL_SIZES;
+    for (const VkDescriptorPoolSize& size : sizesPerSet)
+    {
+        auto found = std::find_if(poolSizes.begin(), poolSizes.end(), [&size](const VkDescriptorPoolSize& poolSize) { return poolSize.type == size.type; });
+        if (found != poolSizes.end())
+            found->descriptorCount += size.descriptorCount;
+        else
+            poolSizes.push_back(size);
+    }
+}
+
+VkDescriptorSet DescriptorAllocator_T::allocate(VkDescriptorSetLayout layout)
+{
+    return allocatePersistent(layout);
+}
+
+VkDescriptorSet DescriptorAllocator_T::allocateFrame(uint32_t frameIndex, VkDescriptorSetLayout layout)
+{
+    return allocateFrom(frameChains[frameIndex], layout);
+}
+
+VkDescriptorSet DescriptorAllocator_T::getSet(VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings)
+{
+    return getCachedSet(persistentChain, layout, bindings);
+}
+
+VkDescriptorSet DescriptorAllocator_T::getFrameSet(uint32_t frameIndex, VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings)
+{
+    return getCachedSet(frameChains[frameIndex], layout, bindings);
+}
+
+void DescriptorAllocator_T::resetFrame(uint32_t frameIndex)
+{
+    //only call once the frame's fence has signalled, every set allocated for it is released at once
+    PoolChain& chain = frameChains[frameIndex];
+    for (VkDescriptorPool pool : chain.pools)
+        vkResetDescriptorPool(device->getHandle(), pool, 0);
+    chain.current = 0;
+    chain.cache.clear();
+}
+
+void DescriptorAllocator_T::releaseBuffer(VkBuffer buffer)
+{
+    releaseWhere([buffer](const DescriptorBinding& binding) { return binding.buffer == buffer; });
+}
+
+void DescriptorAllocator_T::releaseImageView(VkImageView imageView)
+{
+    releaseWhere([imageView](const DescriptorBinding& binding) { return binding.imageView == imageView; });
+}
+
+template<typename Uses>
+void DescriptorAllocator_T::releaseWhere(Uses uses)
+{
+    auto referencesResource = [&uses](const SetKey& key) { return std::any_of(key.bindings.begin(), key.bindings.end(), uses); };
+
+    //frame sets go back to their pool on the next reset, dropping the entry is enough
+    for (PoolChain& chain : frameChains)
+        std::erase_if(chain.cache, [&referencesResource](const auto& entry) { return referencesResource(entry.first); });
+
+    for (auto it = persistentChain.cache.begin(); it != persistentChain.cache.end();)
+    {
+        if (!referencesResource(it->first))
+        {
+            it++;
+            continue;
+        }
+
+        //the set may still be bound by a frame in flight, it is only handed out again once that frame is done
+        VkDescriptorSetLayout layout = it->first.layout;
+        VkDescriptorSet set = it->second;
+        if (deletionQueue != nullptr)
+            deletionQueue->push([this, layout, set]() { freeSets[layout].push_back(set); });
+        else
+            freeSets[layout].push_back(set);
+        it = persistentChain.cache.erase(it);
+    }
+}
+
+VkDescriptorSet DescriptorAllocator_T::allocatePersistent(VkDescriptorSetLayout layout)
+{
+    auto found = freeSets.find(layout);
+    if (found != freeSets.end() && !found->second.empty())
+    {
+        VkDescriptorSet set = found->second.back();
+        found->second.pop_back();
+        return set;
+    }
+    return allocateFrom(persistentChain, layout);
+}
+
+VkDescriptorSet DescriptorAllocator_T::allocateFrom(PoolChain& chain, VkDescriptorSetLayout layout)
+{
+    bool freshPool = chain.pools.empty();
+    if (freshPool)
+        chain.pools.push_back(createPool(chain.nextPoolSets));
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &layout;
+
+    while (true)
+    {
+        allocInfo.descriptorPool = chain.pools[chain.current];
+
+        VkDescriptorSet set;
+        VkResult result = vkAllocateDescriptorSets(device->getHandle(), &allocInfo, &set);
+        if (result == VK_SUCCESS)
+            return set;
+        if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+            throw std::runtime_error("failed to allocate descriptor sets!");
+        //an empty pool that cannot hold the set never will, the pool sizes lack what the layout needs
+        if (freshPool)
+            throw std::runtime_error("failed to allocate descriptor sets, the layout does not fit in a new pool!");
+
+        //this pool is full, move along the chain and grow it when we reach the end
+        chain.current++;
+        freshPool = chain.current == chain.pools.size();
+        if (freshPool)
+        {
+            chain.nextPoolSets = std::min(chain.nextPoolSets * 2, MAX_SETS_PER_POOL);
+            chain.pools.push_back(createPool(chain.nextPoolSets));
+        }
+    }
+}
+
+VkDescriptorSet DescriptorAllocator_T::getCachedSet(PoolChain& chain, VkDescriptorSetLayout layout, const std::vector<DescriptorBinding>& bindings)
+{
+    SetKey key{ layout, bindings };
+    auto found = chain.cache.find(key);
+    if (found != chain.cache.end())
+        return found->second;
+
+    VkDescriptorSet set = &chain == &persistentChain ? allocatePersistent(layout) : allocateFrom(chain, layout);
+
+    std::vector<VkDescriptorBufferInfo> bufferInfos(bindings.size());
+    std::vector<VkDescriptorImageInfo> imageInfos(bindings.size());
+    std::vector<VkWriteDescriptorSet> descriptorWrites(bindings.size());
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        const DescriptorBinding& binding = bindings[i];
+        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[i].dstSet = set;
+        descriptorWrites[i].dstBinding = binding.binding;
+        descriptorWrites[i].dstArrayElement = 0;
+        descriptorWrites[i].descriptorType = binding.type;
+        descriptorWrites[i].descriptorCount = 1;
+
+        if (binding.buffer != VK_NULL_HANDLE)
+        {
+            bufferInfos[i] = { binding.buffer, binding.offset, binding.range };
+            descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+        }
+        else
+        {
+            imageInfos[i] = { binding.sampler, binding.imageView, binding.imageLayout };
+            descriptorWrites[i].pImageInfo = &imageInfos[i];
+        }
+    }
+    vkUpdateDescriptorSets(device->getHandle(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+
+    chain.cache[key] = set;
+    return set;
+}
+
+VkDescriptorPool DescriptorAllocator_T::createPool(uint32_t maxSets)
+{
+    std::vector<VkDescriptorPoolSize> sizes;
+    for (const VkDescriptorPoolSize& size : poolSizes)
+        sizes.push_back({ size.type, std::max(1u, size.descriptorCount) * maxSets });
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(sizes.size());
+    poolInfo.pPoolSizes = sizes.data();
+    poolInfo.maxSets = maxSets;
+
+    VkDescriptorPool pool;
+    if (vkCreateDescriptorPool(device->getHandle(), &poolInfo, nullptr, &pool) != VK_SUCCESS)
+        throw std::runtime_error("failed to create descriptor pool!");
+    return pool;
+}
+
+bool DescriptorAllocator_T::SetKey::operator==(const SetKey& other) const
+{
+    if (layout != other.layout || bindings.size() != other.bindings.size()) return false;
+    for (size_t i = 0; i < bindings.size(); i++)
+    {
+        const DescriptorBinding& a = bindings[i];
+        const DescriptorBinding& b = other.bindings[i];
+        if (a.binding != b.binding || a.type != b.type || a.buffer != b.buffer || a.offset != b.offset || a.range != b.range ||
+            a.imageView != b.imageView || a.sampler != b.sampler || a.imageLayout != b.imageLayout)
+            return false;
+    }
+    return true;
+}
+
+size_t DescriptorAllocator_T::SetKeyHash::operator()(const SetKey& key) const
+{
+    size_t hash = std::hash<VkDescriptorSetLayout>()(key.layout);
+    auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+    for (const DescriptorBinding& binding : key.bindings)
+    {
+        combine(binding.binding);
+        combine(binding.type);
+        combine(std::hash<VkBuffer>()(binding.buffer));
+        combine(binding.offset);
+        combine(binding.range);
+        combine(std::hash<VkImageView>()(binding.imageView));
+        combine(std::hash<VkSampler>()(binding.sampler));
+        combine(binding.imageLayout);
+    }
+    return hash;
+}
@@ -0,0 +1,52 @@
+#include "MYR.h"
+
+using namespace MYR;
+
+DescriptorLayoutCache_T::DescriptorLayoutCache_T(Device device) : device(device) {}
+DescriptorLayoutCache_T::~DescriptorLayoutCache_T()
+{
+    for (auto& kv : layouts)
+        vkDestroyDescriptorSetLayout(device->getHandle(), kv.second, nullptr);
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache_T::getLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    auto found = layouts.find(bindings);
+    if (found != layouts.end())
+        return found->second;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    VkDescriptorSetLayout layout;
+    if (vkCreateDescriptorSetLayout(device->getHandle(), &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+        throw std::runtime_error("failed to create descriptor set layout!");
+
+    layouts[bindings] = layout;
+    return layout;
+}
+
+size_t DescriptorLayoutCache_T::BindingsHash::operator()(const std::vector<VkDescriptorSetLayoutBinding>& bindings) const
+{
+    size_t hash = bindings.size();
+    auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+    for (const VkDescriptorSetLayoutBinding& binding : bindings)
+    {
+        combine(binding.binding);
+        combine(binding.descriptorType);
+        combine(binding.descriptorCount);
+        combine(binding.stageFlags);
+    }
+    return hash;
+}
+
+bool DescriptorLayoutCache_T::BindingsEqual::operator()(const std::vector<VkDescriptorSetLayoutBinding>& a, const std::vector<VkDescriptorSetLayoutBinding>& b) const
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++)
+        if (a[i].binding != b[i].binding || a[i].descriptorType != b[i].descriptorType || a[i].descriptorCount != b[i].descriptorCount || a[i].stageFlags != b[i].stageFlags)
+            return false;
+    return true;
+}
@@ -1,10 +1,15 @@
 #include "MYR.h"
 #include <stdexcept>
 #include <set>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
 
 using namespace MYR;
 
-bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+bool checkDeviceExtensionSupport(VkPhysicalDevice device, const std::vector<const char*>& extensions);
+const std::vector<const char*>& requiredDeviceExtensions(bool headless);
+bool matchesOverride(const std::string& pinned, uint32_t index, const std::string& name);
 VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features, VkPhysicalDevice physicalDevice);
 
 
@@ -35,16 +40,54 @@ void Device_T::initLogicalDevice(bool enableValidationLayers)
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    //everything optional is enabled exactly when pickPhysicalDevice recorded it in the capabilities
     VkPhysicalDeviceFeatures deviceFeatures{};
+    deviceFeatures.fillModeNonSolid = capabilities.fillModeNonSolid; //needed for wireframe PipelineState variants
+    deviceFeatures.textureCompressionBC = capabilities.textureCompressionBC;
+    deviceFeatures.textureCompressionASTC_LDR = capabilities.textureCompressionASTC_LDR;
+
+    VkPhysicalDeviceVulkan12Features enabled12{};
+    enabled12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceVulkan13Features enabled13{};
+    enabled13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+    //descriptor indexing backs the bindless set, it is only enabled when every feature BindlessSet_T relies on is present
+    if (capabilities.descriptorIndexing)
+    {
+        enabled12.descriptorIndexing = VK_TRUE;
+        enabled12.runtimeDescriptorArray = VK_TRUE;
+        enabled12.descriptorBindingPartiallyBound = VK_TRUE;
+        enabled12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        enabled12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        enabled12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        enabled12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+        enabled12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    }
+
+    //frame pacing waits on a single counter signaled with the frame number instead of one fence per frame
+    enabled12.timelineSemaphore = capabilities.timelineSemaphore;
+
+    //barriers go through vkCmdPipelineBarrier2 when available, BarrierBatch falls back to the legacy call otherwise
+    enabled13.synchronization2 = capabilities.synchronization2;
+
+    //lets Command_T render straight into image views, without render pass and framebuffer objects
+    enabled13.dynamicRendering = capabilities.dynamicRendering;
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    if (properties.apiVersion >= VK_API_VERSION_1_2)
+        createInfo.pNext = &enabled12;
+    if (properties.apiVersion >= VK_API_VERSION_1_3)
+        enabled12.pNext = &enabled13;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
 
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    std::vector<const char*> extensions = requiredDeviceExtensions(isHeadless());
+    if (capabilities.memoryBudget)
+        extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
     if (enableValidationLayers)
     {
         createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
@@ -73,15 +116,119 @@ void Device_T::pickPhysicalDevice(VkInstance instance)
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-    for (const auto& device : devices) {
-        physicalDevice = device;
-        if (isDeviceSuitable()) break;
-        physicalDevice = VK_NULL_HANDLE;
+    //MYR_DEVICE takes precedence over setDeviceOverride, so CI can pin a device without a code change
+    std::string pinned = deviceOverride;
+    if (const char* environment = std::getenv("MYR_DEVICE"))
+        pinned = environment;
+
+    VkPhysicalDevice best = VK_NULL_HANDLE;
+    uint64_t bestScore = 0;
+    for (uint32_t i = 0; i < deviceCount; i++)
+    {
+        physicalDevice = devices[i];
+        DeviceCapabilities found = queryCapabilities();
+        if (!pinned.empty() && !matchesOverride(pinned, i, found.name))
+            continue;
+
+        if (!isDeviceSuitable(found))
+        {
+            if (!pinned.empty())
+                throw std::runtime_error("failed to use pinned device " + found.name + ": it lacks a required feature!");
+            continue;
+        }
+
+        uint64_t score = scoreDevice(found);
+        if (best == VK_NULL_HANDLE || score > bestScore)
+        {
+            best = devices[i];
+            bestScore = score;
+            capabilities = found;
+        }
     }
 
+    physicalDevice = best;
     if (physicalDevice == VK_NULL_HANDLE) {
+        if (!pinned.empty())
+            throw std::runtime_error("failed to find a device matching " + pinned + "!");
         throw std::runtime_error("failed to find a suitable GPU!");
     }
+
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+}
+
+DeviceCapabilities Device_T::queryCapabilities()
+{
+    DeviceCapabilities found{};
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    found.name = deviceProperties.deviceName;
+    found.type = deviceProperties.deviceType;
+    found.apiVersion = deviceProperties.apiVersion;
+
+    VkPhysicalDeviceFeatures deviceFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
+    found.fillModeNonSolid = deviceFeatures.fillModeNonSolid;
+    found.textureCompressionBC = deviceFeatures.textureCompressionBC;
+    found.textureCompressionASTC_LDR = deviceFeatures.textureCompressionASTC_LDR;
+
+    VkPhysicalDeviceVulkan12Features supported12{};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceVulkan13Features supported13{};
+    supported13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    if (deviceProperties.apiVersion >= VK_API_VERSION_1_2)
+    {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &supported12;
+        if (deviceProperties.apiVersion >= VK_API_VERSION_1_3)
+            supported12.pNext = &supported13;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+    }
+    found.timelineSemaphore = supported12.timelineSemaphore;
+    found.descriptorIndexing = supported12.descriptorIndexing && supported12.runtimeDescriptorArray && supported12.descriptorBindingPartiallyBound &&
+        supported12.descriptorBindingUpdateUnusedWhilePending && supported12.descriptorBindingStorageBufferUpdateAfterBind &&
+        supported12.descriptorBindingSampledImageUpdateAfterBind && supported12.shaderStorageBufferArrayNonUniformIndexing &&
+        supported12.shaderSampledImageArrayNonUniformIndexing;
+    found.synchronization2 = supported13.synchronization2;
+    found.dynamicRendering = supported13.dynamicRendering;
+
+    uint32_t queueFamilyCount{ 0 };
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    for (uint32_t i = 0; i < queueFamilyCount; i++)
+    {
+        VkQueueFlags flags = queueFamilies[i].queueFlags;
+        VkBool32 presentSupport = isHeadless();
+        if (!isHeadless())
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+
+        if (flags & VK_QUEUE_GRAPHICS_BIT)
+        {
+            found.graphicsQueue = true;
+            found.timestampQueries = found.timestampQueries || queueFamilies[i].timestampValidBits != 0;
+        }
+        found.presentQueue = found.presentQueue || presentSupport;
+        found.asyncComputeQueue = found.asyncComputeQueue || ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT));
+        found.dedicatedTransferQueue = found.dedicatedTransferQueue || ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)));
+    }
+    found.timestampQueries = found.timestampQueries && deviceProperties.limits.timestampPeriod > 0.0f;
+
+    found.swapchain = isHeadless() || checkDeviceExtensionSupport(physicalDevice, deviceExtensions);
+    found.memoryBudget = checkDeviceExtensionSupport(physicalDevice, { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME });
+
+    //tile-based GPUs expose lazily allocated memory, attachments that never leave the tile get no backing store there
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+        if (memProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+            found.lazilyAllocatedMemory = true;
+    for (uint32_t i = 0; i < memProperties.memoryHeapCount; i++)
+        if (memProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            found.deviceLocalMemory = std::max(found.deviceLocalMemory, memProperties.memoryHeaps[i].size);
+
+    return found;
 }
 
 QueueFamilyIndices Device_T::findQueueFamilies()
@@ -96,8 +243,12 @@ QueueFamilyIndices Device_T::findQueueFamilies()
 
     for (int i{ 0 }; i < static_cast<int>(queueFamilyCount); ++i)
     {
+        //without a surface nothing is presented, the present queue is simply the graphics queue
         VkBool32 presentSupport = false;
-        vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
+        if (isHeadless())
+            presentSupport = (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+        else
+            vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
 
         if ((queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && presentSupport) //prioritize case when presentation and graphics use same queue
         {
@@ -147,26 +298,43 @@ SwapChainSupportDetails Device_T::querySwapChainSupport() {
     return details;
 }
 
-bool Device_T::isDeviceSuitable() //Check for separate GPU supporting of geometry shaders
+bool Device_T::isDeviceSuitable(const DeviceCapabilities& found)
 {
-    QueueFamilyIndices indices = findQueueFamilies();
-    if (!indices.allComplete()) return false;
-
-    VkPhysicalDeviceProperties deviceProperties;
-    VkPhysicalDeviceFeatures deviceFeatures;
-    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
-    vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
-
-    bool extensionsSupported = checkDeviceExtensionSupport(physicalDevice);
+    //timeline semaphores pace every frame, everything else the project uses has a fallback
+    if (!found.graphicsQueue || !found.presentQueue || !found.swapchain || !found.timelineSemaphore)
+        return false;
+    if (found.apiVersion < VK_API_VERSION_1_2)
+        return false;
 
-    bool swapChainAdequate = false;
-    if (extensionsSupported)
+    if (!isHeadless())
     {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport();
-        swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
+        if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty())
+            return false;
     }
+    return true;
+}
 
-    return deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU && deviceFeatures.geometryShader && extensionsSupported && swapChainAdequate;
+uint64_t Device_T::scoreDevice(const DeviceCapabilities& found)
+{
+    //the device type dominates, optional features and memory only break ties within a type
+    uint64_t score = 0;
+    switch (found.type)
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score = 4000; break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score = 3000; break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: score = 2000; break;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU: score = 1000; break;
+    default: break;
+    }
+
+    const bool optional[] = { found.synchronization2, found.dynamicRendering, found.descriptorIndexing, found.timestampQueries,
+        found.fillModeNonSolid, found.asyncComputeQueue, found.dedicatedTransferQueue, found.memoryBudget };
+    for (bool present : optional)
+        score += present ? 50 : 0;
+
+    score += std::min<uint64_t>(found.deviceLocalMemory >> 30, 64) * 5; //5 per GiB, capped at 64 GiB
+    return score;
 }
 
 VkFormat Device_T::findDepthFormat() {
@@ -179,17 +347,40 @@ VkFormat Device_T::findDepthFormat() {
 void Device_T::initAllocator(VkInstance instance)
 {
     VmaAllocatorCreateInfo allocatorCreateInfo {};
-    allocatorCreateInfo.flags = VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    if (capabilities.memoryBudget)
+        allocatorCreateInfo.flags = VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
     allocatorCreateInfo.physicalDevice = physicalDevice;
     allocatorCreateInfo.device = device;
     allocatorCreateInfo.instance = instance;
+    //the instance is created for 1.3, without this VMA assumes 1.0 and skips the core 1.1 paths, a 1.2 device caps it at its own version
+    allocatorCreateInfo.vulkanApiVersion = std::min<uint32_t>(VK_API_VERSION_1_3, capabilities.apiVersion);
 
     if (vmaCreateAllocator(&allocatorCreateInfo, &allocator) != VK_SUCCESS)
         throw std::runtime_error("failed to create allocator!");
     
 }
 
-bool checkDeviceExtensionSupport(VkPhysicalDevice device)
+//a number pins the device by enumeration index, anything else is a case-insensitive part of its name
+bool matchesOverride(const std::string& pinned, uint32_t index, const std::string& name)
+{
+    if (!pinned.empty() && std::all_of(pinned.begin(), pinned.end(), [](unsigned char c) { return std::isdigit(c); }))
+        return pinned.size() <= 9 && std::stoul(pinned) == index; //longer numbers are no device index and would overflow stoul
+
+    auto lower = [](std::string text)
+    {
+        std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return text;
+    };
+    return lower(name).find(lower(pinned)) != std::string::npos;
+}
+
+const std::vector<const char*>& requiredDeviceExtensions(bool headless)
+{
+    static const std::vector<const char*> none{};
+    return headless ? none : deviceExtensions;
+}
+
+bool checkDeviceExtensionSupport(VkPhysicalDevice device, const std::vector<const char*>& extensions)
 {
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -197,7 +388,7 @@ bool checkDeviceExtensionSupport(VkPhysicalDevice device)
     std::vector<VkExtensionProperties> availableExtensions(extensionCount);
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
 
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+    std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
 
     for (const auto& extension : availableExtensions)
     {
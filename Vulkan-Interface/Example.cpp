@@ -18,7 +18,7 @@ public:
     void main()
     {
         vary = MYR::PushConstant{ 0,16,&pushConstantValues,VK_SHADER_STAGE_FRAGMENT_BIT };
-        app.createPushConstant(vary);
+        pushConstantIndex = app.createPushConstant(vary);
 
         app.initComponents();
 
@@ -48,12 +48,14 @@ public:
     static bool update(double delta_T)
     {
         instance->pushConstantValues[0] = instance->pushConstantValues[0] + 0.01;
+        instance->app.setPushConstant(instance->pushConstantIndex, &instance->pushConstantValues);
         instance->app.vertices[0].pos.z += 0.01f;
         return true;
     }
 
     BaseApp app{800,600};
     MYR::PushConstant vary;
+    size_t pushConstantIndex;
     glm::vec4 pushConstantValues{ 0.10, 0.10, 0.9,1 };
 private:
     static std::unique_ptr<INSTANCE> instance;
@@ -0,0 +1,81 @@
+#include "MYR.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+using namespace MYR;
+
+namespace
+{
+    //Windows wakes sleeping threads on the system timer tick, 15.6ms by default, so a 1ms sleep would overshoot a whole frame.
+    //the finer period costs power system wide, so it is only held while a frame rate is set
+    void setFineTimer(bool& fineTimer, bool fine)
+    {
+        if (fineTimer == fine)
+            return;
+#ifdef _WIN32
+        if (fine)
+            timeBeginPeriod(1);
+        else
+            timeEndPeriod(1);
+#endif
+        fineTimer = fine;
+    }
+}
+
+FrameLimiter::~FrameLimiter()
+{
+    setFineTimer(fineTimer, false);
+}
+
+void FrameLimiter::setTargetFrameRate(double framesPerSecond)
+{
+    targetFrameTime = std::chrono::steady_clock::duration::zero();
+    if (framesPerSecond > 0.0)
+        targetFrameTime = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / framesPerSecond));
+    nextFrame = {};
+    setFineTimer(fineTimer, targetFrameTime != std::chrono::steady_clock::duration::zero());
+}
+
+void FrameLimiter::wait()
+{
+    if (targetFrameTime == std::chrono::steady_clock::duration::zero())
+        return;
+
+    using clock = std::chrono::steady_clock;
+    const std::chrono::milliseconds sleepStep{ 1 };
+
+    clock::time_point now = clock::now();
+    //first frame, or more than a whole frame late, restart the schedule instead of rushing frames to catch up
+    if (nextFrame == clock::time_point{} || now - nextFrame > targetFrameTime)
+    {
+        nextFrame = now + targetFrameTime;
+        return;
+    }
+
+    //short sleeps while a sleep is unlikely to overshoot the deadline, tracking how long they really take
+    while (nextFrame - now > sleepStep + sleepOvershoot)
+    {
+        std::this_thread::sleep_for(sleepStep);
+        clock::time_point woke = clock::now();
+        std::chrono::nanoseconds overshoot = std::chrono::duration_cast<std::chrono::nanoseconds>(woke - now - sleepStep);
+        //rises at once to a bad wake-up, then decays slowly back down
+        sleepOvershoot = std::max(overshoot, sleepOvershoot - sleepOvershoot / 64);
+        now = woke;
+    }
+
+    while (clock::now() < nextFrame)
+        std::this_thread::yield();
+
+    nextFrame += targetFrameTime;
+}
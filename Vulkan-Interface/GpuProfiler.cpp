@@ -0,0 +1,175 @@
+#include "MYR.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+using namespace MYR;
+
+namespace
+{
+    std::string escapeJson(const std::string& text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            escaped += c;
+        }
+        return escaped;
+    }
+}
+
+GpuProfiler_T::GpuProfiler_T(Device device, uint32_t frameSlots, uint32_t maxScopes) : device(device), maxQueries(maxScopes * 2), frames(frameSlots) {}
+
+GpuProfiler_T::~GpuProfiler_T()
+{
+    for (FrameQueries& frame : frames)
+        vkDestroyQueryPool(device->getHandle(), frame.pool, nullptr);
+}
+
+void GpuProfiler_T::init()
+{
+    //timestamps need a non-zero period and valid bits on the queue the frame is recorded for
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device->getPhysicalDevice(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device->getPhysicalDevice(), &familyCount, families.data());
+
+    uint32_t validBits = families[device->findQueueFamilies().graphicsFamily.value()].timestampValidBits;
+    float timestampPeriod = device->getProperties().limits.timestampPeriod;
+    supported = validBits != 0 && timestampPeriod > 0.0f;
+    if (!supported)
+        return;
+
+    nsPerTick = timestampPeriod;
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = maxQueries;
+    for (FrameQueries& frame : frames)
+        if (vkCreateQueryPool(device->getHandle(), &poolInfo, nullptr, &frame.pool) != VK_SUCCESS)
+            throw std::runtime_error("failed to create timestamp query pool!");
+}
+
+void GpuProfiler_T::beginFrame(VkCommandBuffer commandBuffer, uint32_t slot)
+{
+    recording = nullptr;
+    openScopes.clear();
+    if (!supported)
+        return;
+
+    FrameQueries& frame = frames[slot];
+    resolve(frame);
+
+    vkCmdResetQueryPool(commandBuffer, frame.pool, 0, maxQueries);
+    frame.scopes.clear();
+    frame.usedQueries = 0;
+    frame.frameNumber = ++frameCounter;
+    recording = &frame;
+}
+
+void GpuProfiler_T::beginScope(VkCommandBuffer commandBuffer, const std::string& name)
+{
+    if (recording == nullptr)
+        return;
+
+    if (recording->usedQueries + 2 > maxQueries)
+    {
+        openScopes.push_back(UINT32_MAX);
+        return;
+    }
+
+    uint32_t query = recording->usedQueries;
+    recording->usedQueries += 2;
+    recording->scopes.push_back({ name, query });
+    openScopes.push_back(static_cast<uint32_t>(recording->scopes.size() - 1));
+    writeTimestamp(commandBuffer, recording->pool, query, false);
+}
+
+void GpuProfiler_T::endScope(VkCommandBuffer commandBuffer)
+{
+    if (recording == nullptr || openScopes.empty())
+        return;
+
+    uint32_t scope = openScopes.back();
+    openScopes.pop_back();
+    if (scope != UINT32_MAX)
+        writeTimestamp(commandBuffer, recording->pool, recording->scopes[scope].query + 1, true);
+}
+
+void GpuProfiler_T::writeTimestamp(VkCommandBuffer commandBuffer, VkQueryPool pool, uint32_t query, bool end)
+{
+    if (device->supportsSynchronization2())
+        vkCmdWriteTimestamp2(commandBuffer, end ? VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, pool, query);
+    else
+        vkCmdWriteTimestamp(commandBuffer, end ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pool, query);
+}
+
+void GpuProfiler_T::resolve(FrameQueries& frame)
+{
+    if (frame.usedQueries == 0)
+        return;
+
+    //no WAIT flag, a frame that is not finished yet or left a scope open is dropped rather than stalling the CPU
+    std::vector<uint64_t> timestamps(frame.usedQueries);
+    VkResult result = vkGetQueryPoolResults(device->getHandle(), frame.pool, 0, frame.usedQueries, timestamps.size() * sizeof(uint64_t),
+        timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS)
+        return;
+
+    for (const Scope& scope : frame.scopes)
+    {
+        //masking the difference keeps a counter that wrapped inside the scope correct
+        uint64_t begin = timestamps[scope.query] & timestampMask;
+        uint64_t ticks = (timestamps[scope.query + 1] - timestamps[scope.query]) & timestampMask;
+        double ms = static_cast<double>(ticks) * nsPerTick / 1e6;
+
+        History& samples = history[scope.name];
+        samples.samples[samples.next] = ms;
+        samples.next = (samples.next + 1) % HISTORY;
+        samples.count = std::min(samples.count + 1, HISTORY);
+
+        ScopeStats& scopeStats = stats[scope.name];
+        scopeStats.lastMs = ms;
+        scopeStats.samples = samples.count;
+        scopeStats.minMs = scopeStats.maxMs = ms;
+        double sum = 0;
+        for (uint32_t i = 0; i < samples.count; i++)
+        {
+            sum += samples.samples[i];
+            scopeStats.minMs = std::min(scopeStats.minMs, samples.samples[i]);
+            scopeStats.maxMs = std::max(scopeStats.maxMs, samples.samples[i]);
+        }
+        scopeStats.averageMs = sum / samples.count;
+
+        if (traceCapture && traceEvents.size() < MAX_TRACE_EVENTS)
+        {
+            if (!traceOrigin)
+                traceOrigin = begin;
+            double startUs = (static_cast<double>(begin) - static_cast<double>(*traceOrigin)) * nsPerTick / 1e3;
+            traceEvents.push_back({ scope.name, startUs, ms * 1e3, frame.frameNumber });
+        }
+    }
+    frame.usedQueries = 0;
+}
+
+void GpuProfiler_T::writeChromeTrace(const std::string& path) const
+{
+    //complete ("X") events, chrome://tracing and Perfetto nest them by time
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open trace file " + path + "!");
+
+    file << std::fixed << std::setprecision(3);
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+    for (const TraceEvent& event : traceEvents)
+    {
+        file << ",\n{\"name\":\"" << escapeJson(event.name) << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << event.startUs
+            << ",\"dur\":" << event.durationUs << ",\"args\":{\"frame\":" << event.frameNumber << "}}";
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
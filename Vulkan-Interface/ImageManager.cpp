@@ -1,17 +1,38 @@
 #include "MYR.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 using namespace MYR;
 
 uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkPhysicalDevice physicalDevice);
+VkDeviceSize imageLevelSize(VkFormat format, uint32_t width, uint32_t height); //0 for formats without a known block size
 
-ImageManager_T::ImageManager_T(Device device, Command command) : device(device), command(command) {}
+ImageManager_T::ImageManager_T(Device device, Command command) : device(device), command(command), pendingTransitions(device) {}
 ImageManager_T::~ImageManager_T()
 {
+    waitUploads();
+    for (StagingSegment& segment : stagingSegments)
+    {
+        if (segment.buffer != VK_NULL_HANDLE)
+        {
+            vmaUnmapMemory(device->getAllocator(), segment.allocation);
+            vmaDestroyBuffer(device->getAllocator(), segment.buffer, segment.allocation);
+        }
+        if (syncManager == nullptr)
+            vkDestroyFence(device->getHandle(), segment.fence, nullptr);
+    }
+
+    for (VkSampler sampler : samplers)
+        vkDestroySampler(device->getHandle(), sampler, nullptr);
+    for (VkImageView view : textureViews)
+        vkDestroyImageView(device->getHandle(), view, nullptr);
+
     for (auto& kv : allocations)
         vmaDestroyImage(device->getAllocator(), kv.first, kv.second);
 }
 
-void ImageManager_T::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage* image)
+void ImageManager_T::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage* image, uint32_t mipLevels)
 {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -19,7 +40,7 @@ void ImageManager_T::createImage(uint32_t width, uint32_t height, VkFormat forma
     imageInfo.extent.width = width;
     imageInfo.extent.height = height;
     imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
+    imageInfo.mipLevels = mipLevels;
     imageInfo.arrayLayers = 1;
     imageInfo.format = format;
     imageInfo.tiling = tiling;
@@ -30,6 +51,8 @@ void ImageManager_T::createImage(uint32_t width, uint32_t height, VkFormat forma
 
     VmaAllocationCreateInfo allocInfo = {};
     allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    if (properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+        allocInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
 
     VmaAllocation new_allocation{ };
     if (vmaCreateImage(device->getAllocator(), &imageInfo, &allocInfo, image, &new_allocation, nullptr) != VK_SUCCESS)
@@ -38,7 +61,23 @@ void ImageManager_T::createImage(uint32_t width, uint32_t height, VkFormat forma
     allocations[*image] = std::move(new_allocation);
 }
 
-VkImageView ImageManager_T::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
+void ImageManager_T::destroyImage(VkImage image)
+{
+    auto found = allocations.find(image);
+    if (found == allocations.end())
+        return;
+
+    //frames still in flight may sample or render to it, the queue holds it until they are done
+    VmaAllocator allocator = device->getAllocator();
+    VmaAllocation allocation = found->second;
+    allocations.erase(found);
+    if (deletionQueue != nullptr)
+        deletionQueue->push([allocator, image, allocation]() { vmaDestroyImage(allocator, image, allocation); });
+    else
+        vmaDestroyImage(allocator, image, allocation);
+}
+
+VkImageView ImageManager_T::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels)
 {
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -47,7 +86,7 @@ VkImageView ImageManager_T::createImageView(VkImage image, VkFormat format, VkIm
     viewInfo.format = format;
     viewInfo.subresourceRange.aspectMask = aspectFlags;
     viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.levelCount = mipLevels;
     viewInfo.subresourceRange.baseArrayLayer = 0;
     viewInfo.subresourceRange.layerCount = 1;
 
@@ -59,73 +98,22 @@ VkImageView ImageManager_T::createImageView(VkImage image, VkFormat format, VkIm
     return imageView;
 }
 
-void ImageManager_T::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, bool stencilComponent) {
+void ImageManager_T::transitionImageLayout(VkImage image, VkImageAspectFlags aspectMask, ResourceState from, ResourceState to)
+{
     VkCommandBuffer commandBuffer = command->beginSingleTimeCommands();
 
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    if (newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-
-        if (stencilComponent) 
-            barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-        
-    }
-    else 
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    }
-    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    }
-    else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    }
-    else 
-        throw std::invalid_argument("unsupported layout transition!");
-    
-
-    vkCmdPipelineBarrier(
-        commandBuffer,
-        sourceStage, destinationStage,
-        0,
-        0, nullptr,
-        0, nullptr,
-        1, &barrier
-    );
+    BarrierBatch barriers(device);
+    barriers.transition(image, aspectMask, from, to);
+    barriers.flush(commandBuffer);
 
     command->endSingleTimeCommands(commandBuffer);
 }
 
-
-
+void ImageManager_T::queueLayoutTransition(VkImage image, VkImageAspectFlags aspectMask, ResourceState from, ResourceState to)
+{
+    //no submit of its own, the barrier rides along with the next upload flush, which happens before the next frame is recorded
+    pendingTransitions.transition(image, aspectMask, from, to);
+}
 
 uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, VkPhysicalDevice physicalDevice) {
     VkPhysicalDeviceMemoryProperties memProperties;
@@ -138,4 +126,300 @@ uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties, V
     }
 
     throw std::runtime_error("failed to find suitable memory type!");
-}
\ No newline at end of file
+}
+
+//Texture uploads
+Texture ImageManager_T::createTexture(uint32_t width, uint32_t height, VkFormat format, const void* pixels, VkDeviceSize size, bool generateMipmaps)
+{
+    //only mip 0 is read from pixels, anything past it is ignored
+    VkDeviceSize levelSize = imageLevelSize(format, width, height);
+    if (levelSize == 0)
+        throw std::runtime_error("failed to create texture, the format's texel size is unknown!");
+    if (size < levelSize)
+        throw std::runtime_error("failed to create texture, the pixel data is smaller than width x height texels!");
+
+    Texture texture{};
+    texture.format = format;
+    texture.width = width;
+    texture.height = height;
+    if (generateMipmaps && supportsLinearBlit(format))
+        texture.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+
+    createImage(width, height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texture.image, texture.mipLevels);
+    texture.view = createImageView(texture.image, format, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels);
+    textureViews.push_back(texture.view);
+
+    StagingAllocation staging = allocateStaging(levelSize);
+    memcpy(staging.data, pixels, static_cast<size_t>(levelSize));
+
+    VkBufferImageCopy region{};
+    region.bufferOffset = staging.offset;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { width, height, 1 };
+
+    queueUpload({ texture.image, staging.buffer, width, height, texture.mipLevels, { region } });
+    return texture;
+}
+
+void ImageManager_T::destroyTexture(Texture& texture)
+{
+    //an upload that was never flushed has nothing left to write to
+    std::vector<TextureUpload>& uploads = stagingSegments[currentSegment].uploads;
+    std::erase_if(uploads, [&texture](const TextureUpload& upload) { return upload.image == texture.image; });
+
+    auto found = std::find(textureViews.begin(), textureViews.end(), texture.view);
+    if (found != textureViews.end())
+    {
+        textureViews.erase(found);
+        if (descriptorAllocator != nullptr)
+            descriptorAllocator->releaseImageView(texture.view);
+
+        VkDevice handle = device->getHandle();
+        VkImageView view = texture.view;
+        if (deletionQueue != nullptr)
+            deletionQueue->push([handle, view]() { vkDestroyImageView(handle, view, nullptr); });
+        else
+            vkDestroyImageView(handle, view, nullptr);
+    }
+    destroyImage(texture.image);
+    texture = {};
+}
+
+VkSampler ImageManager_T::createSampler(uint32_t mipLevels, VkFilter filter, VkSamplerAddressMode addressMode)
+{
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = filter;
+    samplerInfo.minFilter = filter;
+    samplerInfo.mipmapMode = filter == VK_FILTER_LINEAR ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = addressMode;
+    samplerInfo.addressModeV = addressMode;
+    samplerInfo.addressModeW = addressMode;
+    samplerInfo.anisotropyEnable = VK_FALSE;
+    samplerInfo.maxAnisotropy = 1.0f;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = static_cast<float>(mipLevels);
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+    VkSampler sampler;
+    if (vkCreateSampler(device->getHandle(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+        throw std::runtime_error("failed to create texture sampler!");
+
+    samplers.push_back(sampler);
+    return sampler;
+}
+
+void ImageManager_T::flushUploads()
+{
+    StagingSegment& segment = stagingSegments[currentSegment];
+    if (segment.uploads.empty() && pendingTransitions.empty())
+        return;
+
+    if (syncManager != nullptr)
+        segment.fence = syncManager->acquireFence();
+    else if (segment.fence == VK_NULL_HANDLE)
+    {
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(device->getHandle(), &fenceInfo, nullptr, &segment.fence) != VK_SUCCESS)
+            throw std::runtime_error("failed to create upload fence!");
+    }
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = command->getTransientCommandPool();
+    allocInfo.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(device->getHandle(), &allocInfo, &segment.commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to allocate upload command buffer!");
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(segment.commandBuffer, &beginInfo);
+
+    pendingTransitions.flush(segment.commandBuffer);
+    if (!segment.uploads.empty())
+        recordUploads(segment.commandBuffer, segment.uploads);
+
+    if (vkEndCommandBuffer(segment.commandBuffer) != VK_SUCCESS)
+        throw std::runtime_error("failed to record upload command buffer!");
+
+    //no wait here, later submissions on the graphics queue are ordered after the final barriers
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &segment.commandBuffer;
+    if (vkQueueSubmit(device->getGraphicsQueue(), 1, &submitInfo, segment.fence) != VK_SUCCESS)
+        throw std::runtime_error("failed to submit texture uploads!");
+
+    segment.inFlight = true;
+    segment.uploads.clear();
+
+    currentSegment = (currentSegment + 1) % STAGING_SEGMENTS;
+    recycleSegment(stagingSegments[currentSegment]);
+}
+
+void ImageManager_T::waitUploads()
+{
+    flushUploads();
+    for (StagingSegment& segment : stagingSegments)
+        recycleSegment(segment);
+}
+
+ImageManager_T::StagingAllocation ImageManager_T::allocateStaging(VkDeviceSize size)
+{
+    //16 bytes covers every texel and compressed block size copies need to be aligned to
+    const VkDeviceSize alignment = 16;
+
+    StagingSegment* segment = &stagingSegments[currentSegment];
+    if (size > STAGING_SEGMENT_SIZE)
+    {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT; //writes are memcpy'd and never flushed
+
+        VkBuffer buffer;
+        VmaAllocation allocation;
+        VmaAllocationInfo allocationInfo;
+        if (vmaCreateBuffer(device->getAllocator(), &bufferInfo, &allocInfo, &buffer, &allocation, &allocationInfo) != VK_SUCCESS)
+            throw std::runtime_error("failed to create staging buffer!");
+
+        segment->oversized.push_back({ buffer, allocation });
+        return { buffer, 0, static_cast<uint8_t*>(allocationInfo.pMappedData) };
+    }
+
+    VkDeviceSize offset = (segment->used + alignment - 1) & ~(alignment - 1);
+    if (offset + size > STAGING_SEGMENT_SIZE)
+    {
+        flushUploads();
+        segment = &stagingSegments[currentSegment];
+        offset = 0;
+    }
+
+    if (segment->buffer == VK_NULL_HANDLE)
+    {
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = STAGING_SEGMENT_SIZE;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo allocInfo{};
+        allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+        allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+        allocInfo.requiredFlags = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+        if (vmaCreateBuffer(device->getAllocator(), &bufferInfo, &allocInfo, &segment->buffer, &segment->allocation, nullptr) != VK_SUCCESS)
+            throw std::runtime_error("failed to create staging buffer!");
+        vmaMapMemory(device->getAllocator(), segment->allocation, reinterpret_cast<void**>(&segment->mapped));
+    }
+
+    segment->used = offset + size;
+    return { segment->buffer, offset, segment->mapped + offset };
+}
+
+void ImageManager_T::queueUpload(TextureUpload&& upload)
+{
+    stagingSegments[currentSegment].uploads.push_back(std::move(upload));
+}
+
+void ImageManager_T::recycleSegment(StagingSegment& segment)
+{
+    if (!segment.inFlight)
+        return;
+
+    vkWaitForFences(device->getHandle(), 1, &segment.fence, VK_TRUE, UINT64_MAX);
+    if (syncManager != nullptr)
+    {
+        syncManager->releaseFence(segment.fence);
+        segment.fence = VK_NULL_HANDLE;
+    }
+    else
+        vkResetFences(device->getHandle(), 1, &segment.fence);
+    vkFreeCommandBuffers(device->getHandle(), command->getTransientCommandPool(), 1, &segment.commandBuffer);
+    segment.commandBuffer = VK_NULL_HANDLE;
+
+    for (auto& buffer : segment.oversized)
+        vmaDestroyBuffer(device->getAllocator(), buffer.first, buffer.second);
+    segment.oversized.clear();
+
+    segment.used = 0;
+    segment.inFlight = false;
+}
+
+void ImageManager_T::recordUploads(VkCommandBuffer commandBuffer, std::vector<TextureUpload>& uploads)
+{
+    BarrierBatch barriers(device);
+
+    //every image of the batch moves to TRANSFER_DST in a single barrier call
+    for (TextureUpload& upload : uploads)
+        barriers.transition(upload.image, VK_IMAGE_ASPECT_COLOR_BIT, ResourceState::Undefined, ResourceState::TransferDst);
+    barriers.flush(commandBuffer);
+
+    for (TextureUpload& upload : uploads)
+        vkCmdCopyBufferToImage(commandBuffer, upload.buffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            static_cast<uint32_t>(upload.regions.size()), upload.regions.data());
+
+    //each level is blitted from the one above it, which is then done and can move to its final layout
+    BarrierBatch finalBarriers(device);
+    for (TextureUpload& upload : uploads)
+    {
+        uint32_t copiedLevels = static_cast<uint32_t>(upload.regions.size());
+        int32_t mipWidth = static_cast<int32_t>(std::max(upload.width >> (copiedLevels - 1), 1u));
+        int32_t mipHeight = static_cast<int32_t>(std::max(upload.height >> (copiedLevels - 1), 1u));
+
+        for (uint32_t level = copiedLevels; level < upload.mipLevels; level++)
+        {
+            barriers.transition(upload.image, VK_IMAGE_ASPECT_COLOR_BIT, ResourceState::TransferDst, ResourceState::TransferSrc, level - 1, 1);
+            barriers.flush(commandBuffer);
+
+            int32_t nextWidth = std::max(mipWidth / 2, 1);
+            int32_t nextHeight = std::max(mipHeight / 2, 1);
+
+            VkImageBlit blit{};
+            blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 };
+            blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+            blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+            blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+            vkCmdBlitImage(commandBuffer, upload.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+            finalBarriers.transition(upload.image, VK_IMAGE_ASPECT_COLOR_BIT, ResourceState::TransferSrc, ResourceState::FragmentShaderRead, level - 1, 1);
+
+            mipWidth = nextWidth;
+            mipHeight = nextHeight;
+        }
+
+        //copied levels that were never a blit source, and the smallest level, are still TRANSFER_DST
+        if (upload.mipLevels == copiedLevels)
+            finalBarriers.transition(upload.image, VK_IMAGE_ASPECT_COLOR_BIT, ResourceState::TransferDst, ResourceState::FragmentShaderRead, 0, upload.mipLevels);
+        else
+        {
+            if (copiedLevels > 1)
+                finalBarriers.transition(upload.image, VK_IMAGE_ASPECT_COLOR_BIT, ResourceState::TransferDst, ResourceState::FragmentShaderRead, 0, copiedLevels - 1);
+            finalBarriers.transition(upload.image, VK_IMAGE_ASPECT_COLOR_BIT, ResourceState::TransferDst, ResourceState::FragmentShaderRead, upload.mipLevels - 1, 1);
+        }
+    }
+    finalBarriers.flush(commandBuffer);
+}
+
+bool ImageManager_T::supportsLinearBlit(VkFormat format)
+{
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(device->getPhysicalDevice(), format, &formatProperties);
+
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (formatProperties.optimalTilingFeatures & required) == required;
+}
@@ -0,0 +1,623 @@
+#include "MYR.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace MYR;
+
+namespace
+{
+    //Read-only view of a whole file, pages are faulted in straight from the page cache as the staging copy touches them
+    class MappedFile
+    {
+    public:
+        MappedFile(const std::string& path)
+        {
+#ifdef _WIN32
+            file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                throw std::runtime_error("failed to open file: " + path);
+
+            LARGE_INTEGER fileSize;
+            GetFileSizeEx(file, &fileSize);
+            size = static_cast<size_t>(fileSize.QuadPart);
+
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping != nullptr)
+                data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+            fd = open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("failed to open file: " + path);
+
+            struct stat status;
+            fstat(fd, &status);
+            size = static_cast<size_t>(status.st_size);
+
+            void* mapped = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+            if (mapped != MAP_FAILED)
+            {
+                data = static_cast<const uint8_t*>(mapped);
+                madvise(mapped, size, MADV_SEQUENTIAL);
+            }
+#endif
+            if (data == nullptr)
+            {
+                close();
+                throw std::runtime_error("failed to map file: " + path);
+            }
+        }
+
+        ~MappedFile() { close(); }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const uint8_t* data{ nullptr };
+        size_t size{ 0 };
+
+    private:
+#ifdef _WIN32
+        HANDLE file{ INVALID_HANDLE_VALUE };
+        HANDLE mapping{ nullptr };
+#else
+        int fd{ -1 };
+#endif
+
+        void close()
+        {
+#ifdef _WIN32
+            if (data != nullptr) UnmapViewOfFile(data);
+            if (mapping != nullptr) CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+            if (data != nullptr) munmap(const_cast<uint8_t*>(data), size);
+            if (fd >= 0) ::close(fd);
+#endif
+            data = nullptr;
+        }
+    };
+
+    const uint8_t Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    struct Ktx2Header
+    {
+        uint8_t identifier[12];
+        uint32_t vkFormat;
+        uint32_t typeSize;
+        uint32_t pixelWidth;
+        uint32_t pixelHeight;
+        uint32_t pixelDepth;
+        uint32_t layerCount;
+        uint32_t faceCount;
+        uint32_t levelCount;
+        uint32_t supercompressionScheme;
+        uint32_t dfdByteOffset;
+        uint32_t dfdByteLength;
+        uint32_t kvdByteOffset;
+        uint32_t kvdByteLength;
+        uint64_t sgdByteOffset;
+        uint64_t sgdByteLength;
+    };
+
+    struct Ktx2Level
+    {
+        uint64_t byteOffset;
+        uint64_t byteLength;
+        uint64_t uncompressedByteLength;
+    };
+
+    //bytes per block and block dimensions, uncompressed formats are 1x1 blocks, all zero for formats without an entry
+    struct FormatBlock
+    {
+        uint32_t bytes;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    FormatBlock blockOf(VkFormat format)
+    {
+        if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK)
+        {
+            static const uint32_t astcBlocks[14][2] = { {4,4}, {5,4}, {5,5}, {6,5}, {6,6}, {8,5}, {8,6}, {8,8}, {10,5}, {10,6}, {10,8}, {10,10}, {12,10}, {12,12} };
+            const uint32_t* dims = astcBlocks[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+            return { 16, dims[0], dims[1] };
+        }
+
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+            return { 8, 4, 4 };
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return { 16, 4, 4 };
+        case VK_FORMAT_R8_UNORM:
+        case VK_FORMAT_R8_SNORM:
+            return { 1, 1, 1 };
+        case VK_FORMAT_R8G8_UNORM:
+        case VK_FORMAT_R8G8_SNORM:
+        case VK_FORMAT_R16_SFLOAT:
+            return { 2, 1, 1 };
+        case VK_FORMAT_R8G8B8A8_UNORM:
+        case VK_FORMAT_R8G8B8A8_SRGB:
+        case VK_FORMAT_B8G8R8A8_UNORM:
+        case VK_FORMAT_B8G8R8A8_SRGB:
+        case VK_FORMAT_R16G16_SFLOAT:
+        case VK_FORMAT_R32_SFLOAT:
+            return { 4, 1, 1 };
+        case VK_FORMAT_R16G16B16A16_SFLOAT:
+        case VK_FORMAT_R32G32_SFLOAT:
+            return { 8, 1, 1 };
+        case VK_FORMAT_R32G32B32A32_SFLOAT:
+            return { 16, 1, 1 };
+        default:
+            return { 0, 0, 0 };
+        }
+    }
+
+    //the format a block-compressed texture is expanded to when the device cannot sample it, UNDEFINED when there is no CPU decoder
+    VkFormat decodedFormatOf(VkFormat format)
+    {
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+            return VK_FORMAT_R8G8B8A8_SRGB;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+            return VK_FORMAT_R8_UNORM;
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+            return VK_FORMAT_R8_SNORM;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+            return VK_FORMAT_R8G8_UNORM;
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+            return VK_FORMAT_R8G8_SNORM;
+        default:
+            return VK_FORMAT_UNDEFINED;
+        }
+    }
+
+
+    //CPU block decoders, each writes one 4x4 block of texels with the given row pitch in texels
+    void decodeBC1(const uint8_t* block, uint8_t* out, size_t pitch, bool hasAlpha)
+    {
+        uint16_t c0 = block[0] | (block[1] << 8);
+        uint16_t c1 = block[2] | (block[3] << 8);
+        uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+
+        uint8_t colors[4][4];
+        auto expand = [](uint16_t c, uint8_t* rgba)
+        {
+            uint8_t r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+            rgba[0] = (r << 3) | (r >> 2);
+            rgba[1] = (g << 2) | (g >> 4);
+            rgba[2] = (b << 3) | (b >> 2);
+            rgba[3] = 255;
+        };
+        expand(c0, colors[0]);
+        expand(c1, colors[1]);
+        for (int i = 0; i < 3; i++)
+        {
+            if (c0 > c1)
+            {
+                colors[2][i] = static_cast<uint8_t>((2 * colors[0][i] + colors[1][i] + 1) / 3);
+                colors[3][i] = static_cast<uint8_t>((colors[0][i] + 2 * colors[1][i] + 1) / 3);
+            }
+            else
+            {
+                colors[2][i] = static_cast<uint8_t>((colors[0][i] + colors[1][i] + 1) / 2);
+                colors[3][i] = 0;
+            }
+        }
+        colors[2][3] = 255;
+        colors[3][3] = (c0 <= c1 && hasAlpha) ? 0 : 255;
+
+        for (int texel = 0; texel < 16; texel++)
+            memcpy(out + ((texel / 4) * pitch + texel % 4) * 4, colors[(indices >> (2 * texel)) & 3], 4);
+    }
+
+    void decodeBC4(const uint8_t* block, uint8_t* out, size_t pitch, size_t stride, bool isSigned)
+    {
+        int values[8];
+        values[0] = isSigned ? std::max(static_cast<int8_t>(block[0]), int8_t(-127)) : block[0];
+        values[1] = isSigned ? std::max(static_cast<int8_t>(block[1]), int8_t(-127)) : block[1];
+        if (values[0] > values[1])
+        {
+            for (int i = 1; i < 7; i++)
+                values[i + 1] = ((7 - i) * values[0] + i * values[1] + 3) / 7;
+        }
+        else
+        {
+            for (int i = 1; i < 5; i++)
+                values[i + 1] = ((5 - i) * values[0] + i * values[1] + 2) / 5;
+            values[6] = isSigned ? -127 : 0;
+            values[7] = isSigned ? 127 : 255;
+        }
+
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; i++)
+            indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+
+        for (int texel = 0; texel < 16; texel++)
+            out[((texel / 4) * pitch + texel % 4) * stride] = static_cast<uint8_t>(values[(indices >> (3 * texel)) & 7]);
+    }
+
+    //BC7 partition masks and anchor indices as listed in the BPTC specification
+    const uint16_t bc7Partitions2[64] =
+    {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+        0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+    };
+
+    const uint8_t bc7Partitions3[64][16] =
+    {
+        {0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2}, {0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1}, {0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1}, {0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1},
+        {0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2}, {0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2}, {0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1}, {0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1},
+        {0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2}, {0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2}, {0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2}, {0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2},
+        {0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2}, {0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2}, {0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2}, {0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0},
+        {0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2}, {0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0}, {0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2}, {0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1},
+        {0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2}, {0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1}, {0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2}, {0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0},
+        {0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0}, {0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2}, {0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0}, {0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1},
+        {0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2}, {0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2}, {0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1}, {0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1},
+        {0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2}, {0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1}, {0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2}, {0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0},
+        {0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0}, {0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0}, {0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0}, {0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1},
+        {0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1}, {0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2}, {0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1}, {0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2},
+        {0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1}, {0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1}, {0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1}, {0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1},
+        {0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2}, {0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1}, {0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2}, {0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2},
+        {0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2}, {0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2}, {0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2}, {0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2},
+        {0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2}, {0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2}, {0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2}, {0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2},
+        {0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1}, {0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2}, {0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2}, {0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0}
+    };
+
+    const uint8_t bc7Anchors2[64] =
+    {
+        15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15, 15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+        15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,  6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15
+    };
+
+    const uint8_t bc7Anchors3Second[64] =
+    {
+         3, 3,15,15, 8, 3,15,15,  8, 8, 6, 6, 6, 5, 3, 3,  3, 3, 8,15, 3, 3, 6,10,  5, 8, 8, 6, 8, 5,15,15,
+         8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15,  3,15, 5, 5, 5, 8, 5,10,  5,10, 8,13,15,12, 3, 3
+    };
+
+    const uint8_t bc7Anchors3Third[64] =
+    {
+        15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8, 15, 8,15, 3,15, 8,15, 8,  3,15, 6,10,15,15,10, 8,
+        15, 3,15,10,10, 8, 9,10,  6,15, 8,15, 3, 6, 6, 8, 15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8
+    };
+
+    const uint8_t bc7Weights2[4] = { 0, 21, 43, 64 };
+    const uint8_t bc7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    const uint8_t bc7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct Bc7Mode
+    {
+        uint8_t subsets;
+        uint8_t partitionBits;
+        uint8_t rotationBits;
+        uint8_t indexSelectionBits;
+        uint8_t colorBits;
+        uint8_t alphaBits;
+        uint8_t endpointPBits;
+        uint8_t sharedPBits;
+        uint8_t indexBits;
+        uint8_t secondaryIndexBits;
+    };
+
+    const Bc7Mode bc7Modes[8] =
+    {
+        { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+    };
+
+    class BitReader
+    {
+    public:
+        BitReader(const uint8_t* data) : data(data) {}
+
+        uint32_t read(uint32_t count)
+        {
+            uint32_t value = 0;
+            for (uint32_t i = 0; i < count; i++, position++)
+                value |= ((data[position >> 3] >> (position & 7)) & 1u) << i;
+            return value;
+        }
+
+    private:
+        const uint8_t* data;
+        uint32_t position{ 0 };
+    };
+
+    void decodeBC7(const uint8_t* block, uint8_t* out, size_t pitch)
+    {
+        BitReader bits(block);
+
+        uint32_t modeIndex = 0;
+        while (modeIndex < 8 && bits.read(1) == 0)
+            modeIndex++;
+        if (modeIndex == 8)
+        {
+            //reserved mode, decoders must output transparent black
+            for (int texel = 0; texel < 16; texel++)
+                memset(out + ((texel / 4) * pitch + texel % 4) * 4, 0, 4);
+            return;
+        }
+        const Bc7Mode& mode = bc7Modes[modeIndex];
+
+        uint32_t partition = bits.read(mode.partitionBits);
+        uint32_t rotation = bits.read(mode.rotationBits);
+        uint32_t indexSelection = bits.read(mode.indexSelectionBits);
+
+        uint32_t endpoints[6][4]{};
+        uint32_t endpointCount = mode.subsets * 2;
+        for (uint32_t channel = 0; channel < 3; channel++)
+            for (uint32_t e = 0; e < endpointCount; e++)
+                endpoints[e][channel] = bits.read(mode.colorBits);
+        for (uint32_t e = 0; e < endpointCount; e++)
+            endpoints[e][3] = mode.alphaBits ? bits.read(mode.alphaBits) : 255;
+
+        uint32_t pBits[6]{};
+        if (mode.endpointPBits)
+            for (uint32_t e = 0; e < endpointCount; e++)
+                pBits[e] = bits.read(1);
+        if (mode.sharedPBits)
+            for (uint32_t s = 0; s < mode.subsets; s++)
+                pBits[s * 2] = pBits[s * 2 + 1] = bits.read(1);
+
+        //append the p-bit and replicate the high bits into the low ones to reach 8 bits
+        bool hasPBit = mode.endpointPBits || mode.sharedPBits;
+        for (uint32_t e = 0; e < endpointCount; e++)
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                uint32_t precision = channel < 3 ? mode.colorBits : mode.alphaBits;
+                if (precision == 0) continue;
+                uint32_t value = endpoints[e][channel];
+                if (hasPBit)
+                {
+                    value = (value << 1) | pBits[e];
+                    precision++;
+                }
+                value <<= 8 - precision;
+                endpoints[e][channel] = value | (value >> precision);
+            }
+
+        auto subsetOf = [&](uint32_t texel) -> uint32_t
+        {
+            if (mode.subsets == 2) return (bc7Partitions2[partition] >> texel) & 1;
+            if (mode.subsets == 3) return bc7Partitions3[partition][texel];
+            return 0;
+        };
+        auto isAnchor = [&](uint32_t texel) -> bool
+        {
+            if (texel == 0) return true;
+            if (mode.subsets == 2) return texel == bc7Anchors2[partition];
+            if (mode.subsets == 3) return texel == bc7Anchors3Second[partition] || texel == bc7Anchors3Third[partition];
+            return false;
+        };
+
+        uint32_t indices[16];
+        for (uint32_t texel = 0; texel < 16; texel++)
+            indices[texel] = bits.read(isAnchor(texel) ? mode.indexBits - 1 : mode.indexBits);
+        uint32_t secondaryIndices[16]{};
+        if (mode.secondaryIndexBits)
+            for (uint32_t texel = 0; texel < 16; texel++)
+                secondaryIndices[texel] = bits.read(texel == 0 ? mode.secondaryIndexBits - 1 : mode.secondaryIndexBits);
+
+        auto weightOf = [](uint32_t indexBits, uint32_t index) -> uint32_t
+        {
+            if (indexBits == 2) return bc7Weights2[index];
+            if (indexBits == 3) return bc7Weights3[index];
+            return bc7Weights4[index];
+        };
+
+        for (uint32_t texel = 0; texel < 16; texel++)
+        {
+            uint32_t subset = subsetOf(texel);
+            const uint32_t* e0 = endpoints[subset * 2];
+            const uint32_t* e1 = endpoints[subset * 2 + 1];
+
+            uint32_t colorWeight = weightOf(mode.indexBits, indices[texel]);
+            uint32_t alphaWeight = colorWeight;
+            if (mode.secondaryIndexBits)
+            {
+                alphaWeight = weightOf(mode.secondaryIndexBits, secondaryIndices[texel]);
+                if (indexSelection)
+                    std::swap(colorWeight, alphaWeight);
+            }
+
+            uint8_t rgba[4];
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                uint32_t weight = channel < 3 ? colorWeight : alphaWeight;
+                rgba[channel] = static_cast<uint8_t>(((64 - weight) * e0[channel] + weight * e1[channel] + 32) >> 6);
+            }
+            if (rotation != 0)
+                std::swap(rgba[3], rgba[rotation - 1]);
+
+            memcpy(out + ((texel / 4) * pitch + texel % 4) * 4, rgba, 4);
+        }
+    }
+
+    //decodes a whole level into tightly packed texels, edge blocks are decoded into scratch and clipped
+    void decodeLevel(VkFormat format, const uint8_t* source, uint8_t* destination, uint32_t width, uint32_t height)
+    {
+        size_t texelSize = blockOf(decodedFormatOf(format)).bytes;
+        size_t blockSize = blockOf(format).bytes;
+        uint32_t blocksX = (width + 3) / 4;
+        uint32_t blocksY = (height + 3) / 4;
+
+        uint8_t scratch[4 * 4 * 4];
+        for (uint32_t by = 0; by < blocksY; by++)
+            for (uint32_t bx = 0; bx < blocksX; bx++)
+            {
+                const uint8_t* block = source + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+                switch (format)
+                {
+                case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                    decodeBC1(block, scratch, 4, false);
+                    break;
+                case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+                case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+                    decodeBC1(block, scratch, 4, true);
+                    break;
+                case VK_FORMAT_BC4_UNORM_BLOCK:
+                case VK_FORMAT_BC4_SNORM_BLOCK:
+                    decodeBC4(block, scratch, 4, 1, format == VK_FORMAT_BC4_SNORM_BLOCK);
+                    break;
+                case VK_FORMAT_BC5_UNORM_BLOCK:
+                case VK_FORMAT_BC5_SNORM_BLOCK:
+                    decodeBC4(block, scratch, 4, 2, format == VK_FORMAT_BC5_SNORM_BLOCK);
+                    decodeBC4(block + 8, scratch + 1, 4, 2, format == VK_FORMAT_BC5_SNORM_BLOCK);
+                    break;
+                default:
+                    decodeBC7(block, scratch, 4);
+                    break;
+                }
+
+                uint32_t columns = std::min(4u, width - bx * 4);
+                uint32_t rows = std::min(4u, height - by * 4);
+                for (uint32_t row = 0; row < rows; row++)
+                    memcpy(destination + ((static_cast<size_t>(by) * 4 + row) * width + bx * 4) * texelSize, scratch + row * 4 * texelSize, columns * texelSize);
+            }
+    }
+}
+
+
+//KTX2 loading
+VkDeviceSize imageLevelSize(VkFormat format, uint32_t width, uint32_t height)
+{
+    FormatBlock block = blockOf(format);
+    if (block.bytes == 0)
+        return 0;
+    return static_cast<VkDeviceSize>((width + block.width - 1) / block.width) * ((height + block.height - 1) / block.height) * block.bytes;
+}
+
+Texture ImageManager_T::loadKTX2(const std::string& path)
+{
+    MappedFile file(path);
+
+    if (file.size < sizeof(Ktx2Header) || memcmp(file.data, Ktx2Identifier, sizeof(Ktx2Identifier)) != 0)
+        throw std::runtime_error("failed to load KTX2: not a KTX2 file: " + path);
+
+    Ktx2Header header;
+    memcpy(&header, file.data, sizeof(Ktx2Header));
+
+    if (header.vkFormat == VK_FORMAT_UNDEFINED)
+        throw std::runtime_error("failed to load KTX2: Basis Universal payloads need a transcoder: " + path);
+    if (header.supercompressionScheme != 0)
+        throw std::runtime_error("failed to load KTX2: supercompressed files are not supported: " + path);
+    if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+        throw std::runtime_error("failed to load KTX2: only single 2D images are supported: " + path);
+
+    uint32_t levelCount = std::max(header.levelCount, 1u);
+    if (file.size < sizeof(Ktx2Header) + levelCount * sizeof(Ktx2Level))
+        throw std::runtime_error("failed to load KTX2: truncated level index: " + path);
+    std::vector<Ktx2Level> levels(levelCount);
+    memcpy(levels.data(), file.data + sizeof(Ktx2Header), levelCount * sizeof(Ktx2Level));
+
+    VkFormat fileFormat = static_cast<VkFormat>(header.vkFormat);
+    FormatBlock block = blockOf(fileFormat);
+    if (block.bytes == 0)
+        throw std::runtime_error("failed to load KTX2: unsupported vkFormat " + std::to_string(fileFormat) + "!");
+
+    //compressed data the device cannot sample is expanded on the CPU while it is written to staging
+    VkFormat format = fileFormat;
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(device->getPhysicalDevice(), fileFormat, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+    {
+        format = decodedFormatOf(fileFormat);
+        if (format == VK_FORMAT_UNDEFINED)
+            throw std::runtime_error("failed to load KTX2: format is not supported by the device and has no CPU decoder: " + path);
+    }
+    bool decode = format != fileFormat;
+    size_t texelSize = blockOf(format).bytes;
+
+    Texture texture{};
+    texture.format = format;
+    texture.width = header.pixelWidth;
+    texture.height = header.pixelHeight;
+    texture.mipLevels = levelCount;
+    //a level count of 0 asks the loader to generate the chain
+    if (header.levelCount == 0 && block.width == 1 && supportsLinearBlit(format))
+        texture.mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texture.width, texture.height)))) + 1;
+
+    //lay every level out in one staging allocation, level 0 is the largest
+    std::vector<VkDeviceSize> stagingOffsets(levelCount);
+    std::vector<VkDeviceSize> stagingSizes(levelCount);
+    VkDeviceSize stagingSize = 0;
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        uint32_t width = std::max(texture.width >> level, 1u);
+        uint32_t height = std::max(texture.height >> level, 1u);
+        VkDeviceSize expected = static_cast<VkDeviceSize>((width + block.width - 1) / block.width) * ((height + block.height - 1) / block.height) * block.bytes;
+        if (levels[level].byteLength < expected || levels[level].byteOffset > file.size || levels[level].byteLength > file.size - levels[level].byteOffset)
+            throw std::runtime_error("failed to load KTX2: level data out of range: " + path);
+
+        stagingOffsets[level] = (stagingSize + 15) & ~VkDeviceSize(15);
+        stagingSizes[level] = decode ? static_cast<VkDeviceSize>(width) * height * texelSize : expected;
+        stagingSize = stagingOffsets[level] + stagingSizes[level];
+    }
+
+    createImage(texture.width, texture.height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texture.image, texture.mipLevels);
+    texture.view = createImageView(texture.image, format, VK_IMAGE_ASPECT_COLOR_BIT, texture.mipLevels);
+    textureViews.push_back(texture.view);
+
+    StagingAllocation staging = allocateStaging(stagingSize);
+
+    TextureUpload upload{ texture.image, staging.buffer, texture.width, texture.height, texture.mipLevels, {} };
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        uint32_t width = std::max(texture.width >> level, 1u);
+        uint32_t height = std::max(texture.height >> level, 1u);
+        const uint8_t* source = file.data + levels[level].byteOffset;
+        uint8_t* destination = staging.data + stagingOffsets[level];
+
+        //the only copy the level data goes through, from the page cache into staging
+        if (decode)
+            decodeLevel(fileFormat, source, destination, width, height);
+        else
+            memcpy(destination, source, static_cast<size_t>(stagingSizes[level]));
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = staging.offset + stagingOffsets[level];
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+        region.imageExtent = { width, height, 1 };
+        upload.regions.push_back(region);
+    }
+    queueUpload(std::move(upload));
+
+    return texture;
+}
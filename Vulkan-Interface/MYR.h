@@ -14,10 +14,22 @@
 #include<unordered_map>
 #include<unordered_set>
 #include<utility>
+#include<string>
+#include<functional>
+#include<mutex>
+#include<atomic>
+#include<thread>
+#include<deque>
+#include<condition_variable>
+#include<chrono>
+#ifdef MYR_RUNTIME_SHADERS
+#include<set>
+#endif
 
 namespace MYR
 {
     typedef class SyncManager_T* SyncManager;
+    typedef class DeletionQueue_T* DeletionQueue;
     typedef class ImageManager_T* ImageManager;
     typedef class BufferManager_T* BufferManager;
     typedef class Window_T* Window;
@@ -27,6 +39,14 @@ namespace MYR
     typedef class Pipeline_T* Pipeline;
     typedef class Command_T* Command;
     typedef class Buffers_T* Buffers;
+    typedef class DescriptorLayoutCache_T* DescriptorLayoutCache;
+    typedef class DescriptorAllocator_T* DescriptorAllocator;
+    typedef class BindlessSet_T* BindlessSet;
+    typedef class RenderGraph_T* RenderGraph;
+    typedef class GpuProfiler_T* GpuProfiler;
+#ifdef MYR_RUNTIME_SHADERS
+    typedef class ShaderCompiler_T* ShaderCompiler;
+#endif
 
     const std::vector<const char*> validationLayers{ "VK_LAYER_KHRONOS_validation" };
 
@@ -43,6 +63,7 @@ namespace MYR
         static std::array<VkVertexInputAttributeDescription, 2> getAttributeDescriptions();
     };
 
+    //data is only the initial value, it is copied when the push constant is registered and changed afterwards with set
     struct PushConstant
     {
         uint16_t offset;
@@ -51,6 +72,161 @@ namespace MYR
         VkShaderStageFlags stages;
     };
 
+    //Fixed-function state that distinguishes pipeline variants, the default matches the original pipeline
+    struct PipelineState
+    {
+        VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+        VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+        VkBool32 blendEnable = VK_TRUE;
+        VkBool32 depthTestEnable = VK_TRUE;
+        VkBool32 depthWriteEnable = VK_TRUE;
+        VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+        bool operator==(const PipelineState&) const = default;
+    };
+
+    struct PipelineStateHash
+    {
+        size_t operator()(const PipelineState&) const;
+    };
+
+    struct ShaderSource
+    {
+        std::string path;
+        VkShaderStageFlagBits stage;
+        std::vector<std::pair<std::string, std::string>> defines{};
+    };
+
+    //Descriptor bindings indexed by set number and push constant ranges, as declared by SPIR-V
+    struct ShaderReflection
+    {
+        std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets;
+        std::vector<VkPushConstantRange> pushConstantRanges;
+    };
+
+    ShaderReflection reflectShader(const std::vector<uint32_t>& code, VkShaderStageFlagBits stage);
+    void mergeReflection(ShaderReflection& into, const ShaderReflection& from);
+
+    //CPU shadow of all registered push constants, pushed as the fewest vkCmdPushConstants calls the layout ranges allow
+    class PushConstantBlock
+    {
+    public:
+        struct Entry
+        {
+            uint32_t offset;
+            uint32_t size;
+            VkShaderStageFlags stages;
+        };
+
+        size_t add(const PushConstant&); //returns the index set takes
+        void setMaxSize(uint32_t maxPushConstantsSize);
+        void setLayoutRanges(const std::vector<VkPushConstantRange>&);
+
+        void set(size_t index, const void* data); //the only way values change, the shadow holds no pointers into caller memory
+        void flush(VkCommandBuffer, VkPipelineLayout);
+
+        const std::vector<Entry>& getEntries() const { return entries; }
+
+    private:
+        struct Segment
+        {
+            uint32_t offset;
+            uint32_t size;
+            VkShaderStageFlags stages;
+        };
+
+        std::vector<Entry> entries;
+        std::vector<VkPushConstantRange> layoutRanges;
+        std::vector<Segment> segments;
+        std::vector<uint32_t> shadow;
+        uint32_t maxSize{ 0 };
+
+        void write(uint32_t offset, uint32_t size, const void* data);
+        void buildSegments();
+    };
+
+    //Contents of one binding, a buffer binding leaves the image fields null and vice versa
+    struct DescriptorBinding
+    {
+        uint32_t binding;
+        VkDescriptorType type;
+        VkBuffer buffer{ VK_NULL_HANDLE };
+        VkDeviceSize offset{ 0 };
+        VkDeviceSize range{ VK_WHOLE_SIZE };
+        VkImageView imageView{ VK_NULL_HANDLE };
+        VkSampler sampler{ VK_NULL_HANDLE };
+        VkImageLayout imageLayout{ VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    };
+
+    //Ways a resource is used, BarrierBatch looks up the narrowest stage, access and layout for each in its state table
+    enum class ResourceState
+    {
+        Undefined,
+        TransferSrc,
+        TransferDst,
+        VertexShaderRead,
+        FragmentShaderRead,
+        ComputeShaderRead,
+        ComputeShaderWrite,
+        ColorAttachment,
+        DepthAttachment,
+        DepthRead,
+        Present,
+        VertexBuffer,
+        IndexBuffer,
+        UniformBuffer,
+        HostWrite,
+        HostRead,
+    };
+
+    //Collects image and buffer barriers and records them as one vkCmdPipelineBarrier2, or one legacy vkCmdPipelineBarrier without synchronization2
+    class BarrierBatch
+    {
+    public:
+        BarrierBatch(Device);
+
+        void transition(VkImage, VkImageAspectFlags, ResourceState from, ResourceState to, uint32_t baseMipLevel = 0, uint32_t levelCount = VK_REMAINING_MIP_LEVELS);
+        void transition(VkBuffer, ResourceState from, ResourceState to, VkDeviceSize offset = 0, VkDeviceSize size = VK_WHOLE_SIZE);
+        void alias(VkImage, VkImageAspectFlags, ResourceState previousOccupant, ResourceState to);
+        void flush(VkCommandBuffer);
+
+        bool empty() const { return imageBarriers.empty() && bufferBarriers.empty(); }
+        static VkImageLayout layoutOf(ResourceState);
+
+    private:
+        Device device;
+
+        std::vector<VkImageMemoryBarrier2> imageBarriers;
+        std::vector<VkBufferMemoryBarrier2> bufferBarriers;
+    };
+
+    //A sampled image created by ImageManager_T, contents are valid once its upload batch has been flushed
+    struct Texture
+    {
+        VkImage image{ VK_NULL_HANDLE };
+        VkImageView view{ VK_NULL_HANDLE };
+        VkFormat format{ VK_FORMAT_UNDEFINED };
+        uint32_t width{ 0 };
+        uint32_t height{ 0 };
+        uint32_t mipLevels{ 1 };
+    };
+
+    //How frames reach the screen, each mode falls back to the closest mode the surface supports
+    enum class PresentMode
+    {
+        VSync,      //FIFO, always available
+        LowLatency, //MAILBOX, newest frame replaces the queued one, falls back to FIFO
+        Uncapped,   //IMMEDIATE, may tear, falls back to MAILBOX then FIFO
+        Adaptive,   //FIFO_RELAXED, tears only when a frame misses vblank, falls back to FIFO
+    };
+
+    struct PresentPolicy
+    {
+        PresentMode mode{ PresentMode::LowLatency };
+        uint32_t imageCount{ 0 }; //0 picks one more than the surface minimum, anything else is clamped to the surface limits
+    };
+
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
@@ -67,6 +243,34 @@ namespace MYR
         std::vector<VkPresentModeKHR> presentModes;
     };
 
+    //what pickPhysicalDevice found on the chosen device, every optional feature is enabled exactly when it is recorded here
+    struct DeviceCapabilities
+    {
+        std::string name;
+        VkPhysicalDeviceType type{ VK_PHYSICAL_DEVICE_TYPE_OTHER };
+        uint32_t apiVersion{ 0 };
+        VkDeviceSize deviceLocalMemory{ 0 }; //largest device-local heap
+
+        //required
+        bool graphicsQueue{ false };
+        bool presentQueue{ false };
+        bool swapchain{ false };
+        bool timelineSemaphore{ false };
+
+        //optional
+        bool descriptorIndexing{ false };
+        bool synchronization2{ false };
+        bool dynamicRendering{ false };
+        bool lazilyAllocatedMemory{ false };
+        bool fillModeNonSolid{ false };
+        bool textureCompressionBC{ false };
+        bool textureCompressionASTC_LDR{ false };
+        bool timestampQueries{ false };
+        bool asyncComputeQueue{ false };
+        bool dedicatedTransferQueue{ false };
+        bool memoryBudget{ false };
+    };
+
     class ImageManager_T;
 
     class Window_T
@@ -81,11 +285,13 @@ namespace MYR
 
         GLFWwindow* getHandle() const { return window; }
         void close_window() { glfwSetWindowShouldClose(window, true); }
+        uint32_t getWidth() const { return WIDTH; }
+        uint32_t getHeight() const { return HEIGHT; }
 
     private:
         const uint32_t WIDTH;
         const uint32_t HEIGHT;
-        GLFWwindow* window;
+        GLFWwindow* window{ nullptr }; //stays null in headless mode, initWindow is never called
     };
 
     class Core_T
@@ -97,6 +303,7 @@ namespace MYR
         void initVulkanInstance();
         void initDebugMessenger();
         void initSurface(Window window);
+        void setHeadless(bool headless) { this->headless = headless; } //no GLFW and no VK_KHR_surface, call before initVulkanInstance
 
         VkInstance getInstance() const { return instance; }
         VkSurfaceKHR getSurface() const { return surface; }
@@ -104,8 +311,9 @@ namespace MYR
     private:
         VkDebugUtilsMessengerEXT debugMessenger;
         VkInstance instance;
-        VkSurfaceKHR surface;
+        VkSurfaceKHR surface{ VK_NULL_HANDLE };
         bool enableValidationLayers;
+        bool headless{ false };
     };
 
     class Device_T
@@ -115,30 +323,45 @@ namespace MYR
         ~Device_T();
 
         void setSurface(VkSurfaceKHR surface) { this->surface = surface; }
+        bool isHeadless() const { return surface == VK_NULL_HANDLE; } //no surface was set, presentation and VK_KHR_swapchain are skipped
+        void setDeviceOverride(const std::string& device) { deviceOverride = device; } //index or part of the name, MYR_DEVICE in the environment wins
         void pickPhysicalDevice(VkInstance);
         void initLogicalDevice(bool);
         SwapChainSupportDetails querySwapChainSupport();
         QueueFamilyIndices findQueueFamilies();
-        bool isDeviceSuitable();
+        bool isDeviceSuitable(const DeviceCapabilities&);
+        uint64_t scoreDevice(const DeviceCapabilities&);
         VkFormat findDepthFormat();
 
         void initAllocator(VkInstance);
 
         VkDevice getHandle() const { return device; }
         VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
+        const VkPhysicalDeviceProperties& getProperties() { return properties; }
+        const DeviceCapabilities& getCapabilities() const { return capabilities; }
+        bool supportsDescriptorIndexing() { return capabilities.descriptorIndexing; }
+        bool supportsSynchronization2() { return capabilities.synchronization2; }
+        bool supportsLazilyAllocatedMemory() { return capabilities.lazilyAllocatedMemory; }
+        bool supportsDynamicRendering() { return capabilities.dynamicRendering; }
+        bool supportsTimelineSemaphore() { return capabilities.timelineSemaphore; }
         VkQueue getGraphicsQueue() { return graphicsQueue; }
         VkQueue getPresentQueue() { return presentQueue; }
         VmaAllocator getAllocator() { return allocator; }
     private:
-        VkSurfaceKHR surface;
+        VkSurfaceKHR surface{ VK_NULL_HANDLE };
 
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        VkPhysicalDeviceProperties properties{};
+        DeviceCapabilities capabilities{};
+        std::string deviceOverride;
         VkDevice device;
 
         VkQueue graphicsQueue;
         VkQueue presentQueue;
 
         VmaAllocator allocator;
+
+        DeviceCapabilities queryCapabilities(); //for the current physicalDevice, never throws so unsuitable devices can be skipped
     };
 
     class SyncManager_T
@@ -148,13 +371,251 @@ namespace MYR
         ~SyncManager_T();
 
         VkSemaphore createSemaphore();
-        VkFence createFence();
+        VkSemaphore createTimelineSemaphore(uint64_t initialValue = 0);
+        VkFence createFence(bool signaled = true);
+
+        //pooled binary semaphores, release only once no submission or present still waits on or signals it
+        VkSemaphore acquireSemaphore();
+        void releaseSemaphore(VkSemaphore);
+        //pooled fences come back unsignaled, released fences are reset together the next time the free list runs dry
+        VkFence acquireFence();
+        void releaseFence(VkFence);
+        size_t getSemaphoreCount() { return semaphores.size(); }
+        size_t getFenceCount() { return fences.size(); }
+
+        //timeline helpers, a value is reached once every submission signaling up to it has completed
+        void waitTimeline(VkSemaphore, uint64_t value, uint64_t timeout = UINT64_MAX);
+        uint64_t getTimelineValue(VkSemaphore);
 
     private:
         Device device;
 
         std::vector<VkSemaphore> semaphores;
         std::vector<VkFence> fences;
+
+        std::vector<VkSemaphore> freeSemaphores;
+        std::vector<VkFence> freeFences;
+        std::vector<VkFence> fencesToReset;
+    };
+
+    //Paces the CPU to a target frame time, sleeping while the deadline is far and spinning for the last stretch
+    class FrameLimiter
+    {
+    public:
+        FrameLimiter() = default;
+        ~FrameLimiter();
+        FrameLimiter(const FrameLimiter&) = delete;
+        FrameLimiter& operator=(const FrameLimiter&) = delete;
+
+        void setTargetFrameRate(double framesPerSecond);
+        void wait();
+
+    private:
+        bool fineTimer{ false }; //the system timer period has been raised to 1ms, Windows only
+        std::chrono::steady_clock::duration targetFrameTime{ 0 };
+        std::chrono::steady_clock::time_point nextFrame{};
+        std::chrono::nanoseconds sleepOvershoot{ std::chrono::milliseconds(1) }; //how late a 1ms sleep has been returning
+    };
+
+    //Records CPU zones into one ring per thread, only the owning thread writes its ring so recording takes no lock.
+    //Use the MYR_PROFILE_* macros, they compile to nothing unless MYR_PROFILE is defined
+    class CpuProfiler
+    {
+    public:
+        class ScopedZone
+        {
+        public:
+            explicit ScopedZone(const char* name) : name(name), begin(now()) {}
+            ~ScopedZone() { record(name, begin, now()); }
+            ScopedZone(const ScopedZone&) = delete;
+            ScopedZone& operator=(const ScopedZone&) = delete;
+
+        private:
+            const char* name;
+            int64_t begin;
+        };
+
+        //names must outlive the profiler, string literals in practice
+        static void record(const char* name, int64_t beginNs, int64_t endNs);
+        static void markFrame() { record("Frame", now(), -1); }
+        static int64_t now() { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count(); }
+        //call between frames, a ring that wraps while it is read can hand out a torn oldest zone
+        static void writeChromeTrace(const std::string& path);
+
+    private:
+        static constexpr size_t RING_SIZE{ 1 << 16 };
+
+        struct Zone
+        {
+            const char* name;
+            int64_t beginNs;
+            int64_t endNs; //negative for instant events
+        };
+        struct ThreadRing
+        {
+            std::array<Zone, RING_SIZE> zones{};
+            std::atomic<uint64_t> written{ 0 };
+            uint32_t threadIndex{ 0 };
+        };
+
+        static ThreadRing& threadRing();
+        static std::deque<ThreadRing>& registry(); //rings outlive their threads so finished threads still export
+        static std::mutex& registryMutex();
+    };
+
+    //Destroy calls are tagged with the value of the frame being recorded and run once the GPU has completed that frame
+    class DeletionQueue_T
+    {
+    public:
+        DeletionQueue_T();
+        ~DeletionQueue_T();
+
+        void push(std::function<void()> deleter);
+        void beginFrame(uint64_t frameValue, uint64_t completedValue);
+        void collect(uint64_t completedValue);
+        void flush();
+
+        uint64_t getFrameValue() const { return frameValue; }
+        size_t size() const { return entries.size(); }
+
+    private:
+        std::deque<std::pair<uint64_t, std::function<void()>>> entries;
+        uint64_t frameValue{ 1 };
+    };
+
+    class DescriptorLayoutCache_T
+    {
+    public:
+        DescriptorLayoutCache_T(Device);
+        ~DescriptorLayoutCache_T();
+
+        VkDescriptorSetLayout getLayout(const std::vector<VkDescriptorSetLayoutBinding>&);
+
+    private:
+        struct BindingsHash
+        {
+            size_t operator()(const std::vector<VkDescriptorSetLayoutBinding>&) const;
+        };
+        struct BindingsEqual
+        {
+            bool operator()(const std::vector<VkDescriptorSetLayoutBinding>&, const std::vector<VkDescriptorSetLayoutBinding>&) const;
+        };
+
+        Device device;
+
+        std::unordered_map<std::vector<VkDescriptorSetLayoutBinding>, VkDescriptorSetLayout, BindingsHash, BindingsEqual> layouts{};
+    };
+
+    //Chains descriptor pools as they fill, per-frame chains are reset wholesale once their frame has retired
+    class DescriptorAllocator_T
+    {
+    public:
+        DescriptorAllocator_T(Device, const int);
+        ~DescriptorAllocator_T();
+
+        void setPoolSizes(const std::vector<VkDescriptorPoolSize>& sizesPerSet);
+
+        VkDescriptorSet allocate(VkDescriptorSetLayout);
+        VkDescriptorSet allocateFrame(uint32_t frameIndex, VkDescriptorSetLayout);
+        VkDescriptorSet getSet(VkDescriptorSetLayout, const std::vector<DescriptorBinding>&);
+        VkDescriptorSet getFrameSet(uint32_t frameIndex, VkDescriptorSetLayout, const std::vector<DescriptorBinding>&);
+        void resetFrame(uint32_t frameIndex);
+
+        //cached sets are keyed on raw handles, call these when a bound resource is destroyed so a reused handle never hits a stale set
+        void releaseBuffer(VkBuffer);
+        void releaseImageView(VkImageView);
+        void setDeletionQueue(DeletionQueue deletionQueue) { this->deletionQueue = deletionQueue; } //released persistent sets are reused once in-flight frames are done
+
+    private:
+        static constexpr uint32_t MAX_SETS_PER_POOL{ 4096 };
+
+        struct SetKey
+        {
+            VkDescriptorSetLayout layout;
+            std::vector<DescriptorBinding> bindings;
+
+            bool operator==(const SetKey&) const;
+        };
+        struct SetKeyHash
+        {
+            size_t operator()(const SetKey&) const;
+        };
+
+        struct PoolChain
+        {
+            std::vector<VkDescriptorPool> pools;
+            size_t current{ 0 };
+            uint32_t nextPoolSets{ 64 };
+            std::unordered_map<SetKey, VkDescriptorSet, SetKeyHash> cache;
+        };
+
+        Device device;
+        DeletionQueue deletionQueue{ nullptr };
+
+        std::vector<VkDescriptorPoolSize> poolSizes;
+        PoolChain persistentChain;
+        std::vector<PoolChain> frameChains;
+        std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> freeSets; //persistent sets whose resources were destroyed
+
+        template<typename Uses>
+        void releaseWhere(Uses uses);
+        VkDescriptorSet allocatePersistent(VkDescriptorSetLayout);
+        VkDescriptorSet allocateFrom(PoolChain&, VkDescriptorSetLayout);
+        VkDescriptorSet getCachedSet(PoolChain&, VkDescriptorSetLayout, const std::vector<DescriptorBinding>&);
+        VkDescriptorPool createPool(uint32_t maxSets);
+    };
+
+    //One update-after-bind set holding every storage buffer, sampled image and sampler, shaders index it with ids passed in push constants or instance data
+    class BindlessSet_T
+    {
+    public:
+        static constexpr uint32_t SET_INDEX{ 1 };
+        static constexpr uint32_t STORAGE_BUFFER_BINDING{ 0 };
+        static constexpr uint32_t SAMPLED_IMAGE_BINDING{ 1 };
+        static constexpr uint32_t SAMPLER_BINDING{ 2 };
+
+        BindlessSet_T(Device, uint32_t maxBuffers = 16384, uint32_t maxImages = 16384, uint32_t maxSamplers = 64);
+        ~BindlessSet_T();
+
+        void init();
+
+        uint32_t addBuffer(VkBuffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+        uint32_t addImage(VkImageView, VkImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        uint32_t addSampler(VkSampler);
+        void setBuffer(uint32_t index, VkBuffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+        void setImage(uint32_t index, VkImageView, VkImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        void setSampler(uint32_t index, VkSampler);
+
+        //the slot is reused by the next add, only release it once no frame in flight still reads it
+        void removeBuffer(uint32_t index) { buffers.release(index); }
+        void removeImage(uint32_t index) { images.release(index); }
+        void removeSampler(uint32_t index) { samplers.release(index); }
+
+        VkDescriptorSetLayout getLayout() { return descriptorSetLayout; }
+        VkDescriptorSet getHandle() { return descriptorSet; }
+
+    private:
+        struct Slots
+        {
+            uint32_t capacity;
+            uint32_t next{ 0 };
+            std::vector<uint32_t> freeList;
+
+            uint32_t acquire();
+            void release(uint32_t index);
+        };
+
+        Device device;
+
+        VkDescriptorSetLayout descriptorSetLayout{ VK_NULL_HANDLE };
+        VkDescriptorPool descriptorPool{ VK_NULL_HANDLE };
+        VkDescriptorSet descriptorSet{ VK_NULL_HANDLE };
+
+        Slots buffers;
+        Slots images;
+        Slots samplers;
+
+        void write(uint32_t binding, uint32_t index, VkDescriptorType, const VkDescriptorBufferInfo*, const VkDescriptorImageInfo*);
     };
 
     class SwapChain_T
@@ -163,7 +624,11 @@ namespace MYR
         SwapChain_T(Device);
         ~SwapChain_T();
 
-        void initSwapChain(VkSurfaceKHR, GLFWwindow*);
+        void setPresentPolicy(const PresentPolicy& presentPolicy) { this->presentPolicy = presentPolicy; }
+        void initSwapChain(VkSurfaceKHR, GLFWwindow*, VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
+        //headless replacement for initSwapChain, a ring of images owned by the image manager that can be copied out instead of presented
+        void initOffscreen(VkExtent2D, VkFormat, uint32_t imageCount, ImageManager);
+        bool isOffscreen() { return offscreen; }
         void initImageViews();
         void initDepthStencil(ImageManager);
         void initFramebuffers(VkRenderPass);
@@ -172,14 +637,22 @@ namespace MYR
         VkSwapchainKHR getHandle() { return swapChain; }
         VkFormat getImageFormat() { return swapChainImageFormat; };
         uint32_t getImageCount() { return imageCount; }
+        VkPresentModeKHR getPresentMode() { return presentMode; }
+        VkImage getImage(size_t index) { return swapChainImages[index]; }
         VkImageView getView(size_t index) { return swapChainImageViews[index]; }
         VkExtent2D getExtent() { return swapChainExtent; }
         VkFramebuffer getFramebuffer(uint32_t imageIndex) { return Framebuffers[imageIndex]; }
+        VkImage getDepthImage() { return depthImage; }
+        VkImageView getDepthView() { return depthImageView; }
+        VkFormat getDepthFormat() { return depthFormat; }
 
     private:
         Device device;
 
-        VkSwapchainKHR swapChain;
+        VkSwapchainKHR swapChain{ VK_NULL_HANDLE };
+        bool offscreen{ false };
+        PresentPolicy presentPolicy{};
+        VkPresentModeKHR presentMode{ VK_PRESENT_MODE_FIFO_KHR };
         uint32_t imageCount;
         std::vector<VkImage> swapChainImages;
         std::vector<VkImageView> swapChainImageViews;
@@ -187,9 +660,43 @@ namespace MYR
         VkFormat swapChainImageFormat;
         VkExtent2D swapChainExtent;
 
-        VkImage depthImage;
-        VkImageView depthImageView;
+        ImageManager imageManager{ nullptr };
+        VkImage depthImage{ VK_NULL_HANDLE };
+        VkImageView depthImageView{ VK_NULL_HANDLE };
+        VkFormat depthFormat{ VK_FORMAT_UNDEFINED };
+    };
+
+#ifdef MYR_RUNTIME_SHADERS
+    //Compiles GLSL in-process with shaderc (link shaderc_shared), caching SPIR-V on disk by a hash of the preprocessed source
+    class ShaderCompiler_T
+    {
+    public:
+        ShaderCompiler_T(const std::string& cacheDirectory);
+        ~ShaderCompiler_T();
+
+        std::vector<uint32_t> compile(const ShaderSource&, std::vector<std::string>* dependencies = nullptr);
+        void watch(const std::vector<ShaderSource>&, const std::vector<std::string>& dependencies, std::function<void(std::vector<std::vector<uint32_t>>&)> onRebuilt);
+
+    private:
+        struct WatchEntry
+        {
+            std::vector<ShaderSource> shaders;
+            std::vector<std::string> dependencies;
+            std::function<void(std::vector<std::vector<uint32_t>>&)> onRebuilt;
+        };
+
+        std::string cacheDirectory;
+
+        std::vector<WatchEntry> watchEntries;
+        std::mutex watchMutex;
+        std::atomic<bool> running{ false };
+        std::atomic<bool> entriesChanged{ false };
+        std::thread watcher;
+
+        void watchLoop();
+        void rebuildChanged(const std::set<std::string>& changedFiles);
     };
+#endif
 
     class Pipeline_T
     {
@@ -197,30 +704,92 @@ namespace MYR
         Pipeline_T(Device);
         ~Pipeline_T();
 
-        void initRenderPass(VkFormat);
-        void initDescriptorSetLayout();
+        void initRenderPass(VkFormat, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        void initRenderingFormats(VkFormat colorFormat, VkFormat depthFormat);
+        void initDescriptorSetLayout(DescriptorLayoutCache);
         void initGraphicsPipeline();
-        void addPushConstant(PushConstant);
+        void setBindlessSet(BindlessSet bindlessSet) { this->bindlessSet = bindlessSet; }
+        size_t addPushConstant(PushConstant);
+        void setShaderCode(const uint32_t* vertCode, size_t vertSize, const uint32_t* fragCode, size_t fragSize);
+#ifdef MYR_RUNTIME_SHADERS
+        void setShaderSources(ShaderCompiler, const ShaderSource& vert, const ShaderSource& frag, bool hotReload);
+#endif
+        bool reloadShaders();
+        VkPipeline getPipeline(const PipelineState&);
+        VkPipeline requestPipeline(const PipelineState&);
+        void setUseFallbackPipeline(bool useFallback) { useFallbackPipeline = useFallback; }
+        void setDeletionQueue(DeletionQueue deletionQueue) { this->deletionQueue = deletionQueue; } //pipelines replaced by a reload are freed once in-flight frames are done
+        void waitForCompiles();
 
         VkPipeline getHandle() { return graphicsPipeline; }
         VkRenderPass getRenderPass() { return renderPass; }
-        VkDescriptorSetLayout getDescriptorLayout() { return descriptorSetLayout; }
+        bool usesDynamicRendering() { return dynamicRendering; }
+        VkDescriptorSetLayout getDescriptorLayout(uint32_t set = 0) { return set < descriptorSetLayouts.size() ? descriptorSetLayouts[set] : VK_NULL_HANDLE; }
+        std::vector<VkDescriptorPoolSize> getDescriptorPoolSizes(uint32_t setCount);
         VkPipelineLayout getPipelineLayout() { return pipelineLayout; }
+        BindlessSet getBindlessSet() { return bindlessSet; }
 
-        std::vector<PushConstant>& getPushConstants() { return pushConstants; }
+        PushConstantBlock& getPushConstantBlock() { return pushConstantBlock; }
 
     private:
         Device device;
 
-        VkRenderPass renderPass;
-        VkPipelineLayout pipelineLayout;
-        VkPipeline graphicsPipeline;
-
-        VkDescriptorSetLayout descriptorSetLayout;
-
-        std::vector<PushConstant> pushConstants;
+        VkRenderPass renderPass{ VK_NULL_HANDLE };
+        VkPipelineLayout pipelineLayout{ VK_NULL_HANDLE };
+
+        //attachment formats pipelines are built against when there is no render pass
+        bool dynamicRendering{ false };
+        VkFormat colorFormat{ VK_FORMAT_UNDEFINED };
+        VkFormat depthFormat{ VK_FORMAT_UNDEFINED };
+        VkPipeline graphicsPipeline{ VK_NULL_HANDLE };
+        std::unordered_map<PipelineState, VkPipeline, PipelineStateHash> pipelines{};
+        VkPipelineCache pipelineCache{ VK_NULL_HANDLE };
+
+        //background compilation of variants requested through requestPipeline
+        std::vector<std::thread> compileWorkers;
+        std::deque<PipelineState> compileQueue;
+        std::mutex compileMutex;
+        std::condition_variable compileCondition;
+        std::condition_variable compileIdleCondition;
+        uint32_t activeCompiles{ 0 };
+        bool stopCompiling{ false };
+        bool useFallbackPipeline{ true };
+        DeletionQueue deletionQueue{ nullptr };
+
+        VkShaderModule vertShaderModule{ VK_NULL_HANDLE };
+        VkShaderModule fragShaderModule{ VK_NULL_HANDLE };
+        uint32_t shaderGeneration{ 0 }; //bumped by every reload, variants compiled against older modules are dropped
+        std::vector<VkShaderModule> retiredShaderModules; //freed once no worker can still be compiling with them
+
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+        std::vector<std::vector<VkDescriptorSetLayoutBinding>> descriptorBindings;
+        BindlessSet bindlessSet{ nullptr };
+
+        PushConstantBlock pushConstantBlock;
         std::vector<VkPushConstantRange> pushConstantRanges;
-
+        bool reflected{ false };
+
+        std::vector<uint32_t> vertShaderCode;
+        std::vector<uint32_t> fragShaderCode;
+
+        //hot reload: new code is queued for a compile worker, which builds the modules and default pipeline for reloadShaders to swap in
+        bool reloadQueued{ false };
+        std::atomic<bool> reloadPending{ false };
+        std::vector<uint32_t> pendingVertShaderCode;
+        std::vector<uint32_t> pendingFragShaderCode;
+        VkShaderModule pendingVertShaderModule{ VK_NULL_HANDLE };
+        VkShaderModule pendingFragShaderModule{ VK_NULL_HANDLE };
+        VkPipeline pendingPipeline{ VK_NULL_HANDLE };
+
+        VkPipeline createPipeline(const PipelineState&, VkShaderModule vert, VkShaderModule frag);
+        VkPipeline storePipeline(const PipelineState&, VkPipeline, uint32_t generation);
+        void startCompileWorkers();
+        void compileLoop();
+        void buildReload(std::vector<uint32_t> vertCode, std::vector<uint32_t> fragCode);
+        void destroyPendingReload();
+        void destroyRetiredModules();
+        void destroyPipelines();
+        void checkPushConstant(const PushConstantBlock::Entry&);
     };
 
 
@@ -232,24 +801,61 @@ namespace MYR
 
         void initCommandPool();
         void initCommandBuffers();
-        void recordCommandBuffer(uint32_t, uint32_t, VkBuffer, uint32_t, std::vector<VkDescriptorSet>*);
-        void submitCommandBuffer(uint32_t currentFrame, uint32_t imageIndex, VkSemaphore, std::vector<VkSemaphore>& signalSemaphores, VkFence);
+        //a readback buffer only applies to offscreen targets, the rendered image is copied into it tightly packed
+        void recordCommandBuffer(uint32_t, uint32_t, VkBuffer, uint32_t, std::vector<VkDescriptorSet>*, const PipelineState& = {}, VkBuffer readbackBuffer = VK_NULL_HANDLE);
+        void submitCommandBuffer(uint32_t currentFrame, uint32_t imageIndex, VkSemaphore, std::vector<VkSemaphore>& signalSemaphores, VkSemaphore timeline, uint64_t timelineValue);
         VkCommandBuffer beginSingleTimeCommands();
         void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 
         VkCommandBuffer_T** refCommandfBuffer(uint32_t bufferIndex) { return &(commandBuffers[bufferIndex]); }
         VkCommandPool getTransientCommandPool() { return transientCommandPool; }
         void set_swapChain(SwapChain swapChain) { this->swapChain = swapChain; }
+        void set_syncManager(SyncManager syncManager) { this->syncManager = syncManager; }
+        void set_gpuProfiler(GpuProfiler gpuProfiler) { this->gpuProfiler = gpuProfiler; }
+        void set_deletionQueue(DeletionQueue deletionQueue) { this->deletionQueue = deletionQueue; }
+
+        //named GPU timing scopes, no-ops without a profiler or when the queue has no timestamp support
+        void beginGpuScope(VkCommandBuffer, const std::string& name);
+        void endGpuScope(VkCommandBuffer);
 
     private:
         const int MAX_FRAMES_IN_FLIGHT;
         Device device;
         Pipeline pipeline;
         SwapChain swapChain;
+        SyncManager syncManager{ nullptr };
+        GpuProfiler gpuProfiler{ nullptr };
+        DeletionQueue deletionQueue{ nullptr };
 
         VkCommandPool commandPool;
         VkCommandPool transientCommandPool;
         std::vector<VkCommandBuffer> commandBuffers;
+
+        //what the frame graph passes record, set at the start of every recordCommandBuffer
+        struct FrameInputs
+        {
+            uint32_t frameIndex;
+            uint32_t imageIndex;
+            VkBuffer viBuffer;
+            uint32_t indexCount;
+            std::vector<VkDescriptorSet>* descriptorSets;
+            PipelineState pipelineState;
+            VkBuffer readbackBuffer;
+        };
+        FrameInputs frame{};
+
+        //dynamic rendering frames go through the graph, rebuilt only when the readback or offscreen setup changes
+        RenderGraph frameGraph{ nullptr };
+        uint32_t colorTarget{ 0 };
+        uint32_t depthTarget{ 0 };
+        uint32_t readbackTarget{ 0 };
+        bool frameGraphReadback{ false };
+        bool frameGraphOffscreen{ false };
+
+        void buildFrameGraph(bool readback);
+        void recordDraw(VkCommandBuffer);
+        void recordReadback(VkCommandBuffer);
+        void beginDynamicRendering(VkCommandBuffer, uint32_t imageIndex);
     };
 
 
@@ -260,15 +866,78 @@ namespace MYR
         ~ImageManager_T();
 
 
-        void createImage(uint32_t, uint32_t, VkFormat, VkImageTiling, VkImageUsageFlags, VkMemoryPropertyFlags, VkImage*);
-        VkImageView createImageView(VkImage, VkFormat, VkImageAspectFlags);
-        void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, bool stencilComponent = false);
+        void createImage(uint32_t, uint32_t, VkFormat, VkImageTiling, VkImageUsageFlags, VkMemoryPropertyFlags, VkImage*, uint32_t mipLevels = 1);
+        VkImageView createImageView(VkImage, VkFormat, VkImageAspectFlags, uint32_t mipLevels = 1);
+        void destroyImage(VkImage);
+        void setDeletionQueue(DeletionQueue deletionQueue) { this->deletionQueue = deletionQueue; }
+        void setSyncManager(SyncManager syncManager) { this->syncManager = syncManager; }
+        void setDescriptorAllocator(DescriptorAllocator descriptorAllocator) { this->descriptorAllocator = descriptorAllocator; }
+        void transitionImageLayout(VkImage, VkImageAspectFlags, ResourceState from, ResourceState to); //submits and waits
+        void queueLayoutTransition(VkImage, VkImageAspectFlags, ResourceState from, ResourceState to); //recorded with the next flushUploads
+
+        Texture createTexture(uint32_t width, uint32_t height, VkFormat, const void* pixels, VkDeviceSize size, bool generateMipmaps = true);
+        Texture loadKTX2(const std::string& path);
+        void destroyTexture(Texture&); //the image and view outlive the frames in flight through the deletion queue, texture is reset
+        VkSampler createSampler(uint32_t mipLevels, VkFilter filter = VK_FILTER_LINEAR, VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
+        void flushUploads();
+        void waitUploads();
 
     private:
+        static constexpr uint32_t STAGING_SEGMENTS{ 4 };
+        static constexpr VkDeviceSize STAGING_SEGMENT_SIZE{ 16 * 1024 * 1024 };
+
+        struct StagingAllocation
+        {
+            VkBuffer buffer;
+            VkDeviceSize offset;
+            uint8_t* data;
+        };
+
+        //copies into one image, mip levels past the copied ones are blitted down from the last copied level
+        struct TextureUpload
+        {
+            VkImage image;
+            VkBuffer buffer;
+            uint32_t width;
+            uint32_t height;
+            uint32_t mipLevels;
+            std::vector<VkBufferImageCopy> regions;
+        };
+
+        //the staging ring is split into segments, each flushed as one batch and recycled once its fence signals, fences are pooled by the sync manager when one is set
+        struct StagingSegment
+        {
+            VkBuffer buffer{ VK_NULL_HANDLE };
+            VmaAllocation allocation{};
+            uint8_t* mapped{ nullptr };
+            VkDeviceSize used{ 0 };
+
+            VkFence fence{ VK_NULL_HANDLE };
+            VkCommandBuffer commandBuffer{ VK_NULL_HANDLE };
+            bool inFlight{ false };
+            std::vector<TextureUpload> uploads;
+            std::vector<std::pair<VkBuffer, VmaAllocation>> oversized; //uploads larger than a whole segment
+        };
+
         Device device;
         Command command;
+        DeletionQueue deletionQueue{ nullptr };
+        SyncManager syncManager{ nullptr };
+        DescriptorAllocator descriptorAllocator{ nullptr };
 
         std::unordered_map<VkImage, VmaAllocation> allocations{};
+        std::vector<VkImageView> textureViews;
+        std::vector<VkSampler> samplers;
+
+        std::array<StagingSegment, STAGING_SEGMENTS> stagingSegments{};
+        uint32_t currentSegment{ 0 };
+        BarrierBatch pendingTransitions; //recorded ahead of the uploads on the next flush
+
+        StagingAllocation allocateStaging(VkDeviceSize size);
+        void queueUpload(TextureUpload&&);
+        void recycleSegment(StagingSegment&);
+        void recordUploads(VkCommandBuffer, std::vector<TextureUpload>&);
+        bool supportsLinearBlit(VkFormat);
     };
 
     class BufferManager_T
@@ -279,13 +948,18 @@ namespace MYR
 
         void createBuffer(VkDeviceSize, VkBufferUsageFlags, VkMemoryPropertyFlags, VmaAllocationCreateFlags, VkBuffer*);
         void destroyBuffer(VkBuffer);
+        void setDeletionQueue(DeletionQueue deletionQueue) { this->deletionQueue = deletionQueue; }
+        void setDescriptorAllocator(DescriptorAllocator descriptorAllocator) { this->descriptorAllocator = descriptorAllocator; }
         void copyBuffer(VkBuffer, VkBuffer, uint32_t, VkDeviceSize);
         void mapMemory(VkBuffer, void**);
         void unmapMemory(VkBuffer);
+        void invalidate(VkBuffer); //makes device writes visible to a mapping of non-coherent memory
 
     private:
         Device device;
         Command command;
+        DeletionQueue deletionQueue{ nullptr };
+        DescriptorAllocator descriptorAllocator{ nullptr };
 
         std::unordered_map<VkBuffer, VmaAllocation> allocations{};
         std::unordered_set<VkBuffer> mappedBuffers{};
@@ -299,10 +973,11 @@ namespace MYR
 
         void createVIBuffer(BufferManager bufferManager, const std::vector<Vertex>&, const std::vector<uint32_t>&);
         void initUniformBuffers(BufferManager bufferManager, size_t);
-        void initDescriptorPool();
-        void initDescriptorSets();
+        void initDescriptorSets(DescriptorAllocator descriptorAllocator);
+        void setBindlessSet(BindlessSet bindlessSet) { this->bindlessSet = bindlessSet; }
 
         VkBuffer getVIBuffer() { return viBuffer; }
+        uint32_t getVIBufferIndex() { return viBufferIndex; }
 
         void updateUniformBuffer(uint32_t imageIndex, void* ubo, size_t uboSize) { memcpy(uniformBuffersMapped[imageIndex], ubo, uboSize); }
 
@@ -315,11 +990,12 @@ namespace MYR
         Pipeline pipeline;
         Command command;
 
-        VkDescriptorPool descriptorPool;
         std::vector<VkDescriptorSet> descriptorSets;
+        BindlessSet bindlessSet{ nullptr };
 
         VmaAllocation viBufferAllocation;
         VkBuffer viBuffer{NULL};
+        uint32_t viBufferIndex{ UINT32_MAX }; //slot in the bindless set, UINT32_MAX when bindless is off
         uint32_t index_count;
         uint32_t vertex_count;
 
@@ -327,4 +1003,224 @@ namespace MYR
         std::vector<void*> uniformBuffersMapped;
     };
 
-}
\ No newline at end of file
+    //Frame graph: passes declare the resources they read and write, compile() culls passes nothing depends on and
+    //places transient images with disjoint lifetimes in shared memory, execute() records the barriers between passes
+    class RenderGraph_T
+    {
+    public:
+        typedef uint32_t Resource;
+        typedef std::function<void(VkCommandBuffer, RenderGraph_T&)> PassCallback;
+
+        struct ImageDesc
+        {
+            uint32_t width;
+            uint32_t height;
+            VkFormat format;
+            VkImageUsageFlags usage;
+            VkImageAspectFlags aspect{ VK_IMAGE_ASPECT_COLOR_BIT };
+        };
+
+        class Pass
+        {
+        public:
+            Pass& read(Resource, ResourceState);
+            Pass& write(Resource, ResourceState); //a write that keeps earlier contents (load op LOAD) should also read
+            Pass& sideEffects() { keep = true; return *this; } //never culled, e.g. readbacks or uploads
+
+        private:
+            friend class RenderGraph_T;
+            struct Access
+            {
+                Resource resource;
+                ResourceState state;
+                bool write;
+            };
+
+            std::string name;
+            PassCallback callback;
+            std::vector<Access> accesses;
+            bool keep{ false };
+            bool culled{ false };
+        };
+
+        RenderGraph_T(Device);
+        ~RenderGraph_T();
+
+        Resource createImage(const std::string& name, const ImageDesc&);
+        Resource importImage(const std::string& name, VkImageAspectFlags, ResourceState initialState, ResourceState finalState);
+        Resource importBuffer(const std::string& name, ResourceState initialState, ResourceState finalState);
+        void setImage(Resource, VkImage, VkImageView); //imported handles may change every frame, e.g. the acquired swapchain image
+        void setBuffer(Resource, VkBuffer);
+        void markOutput(Resource);
+
+        Pass& addPass(const std::string& name, PassCallback); //declare its accesses right away, the reference dies with the next addPass
+
+        void compile();
+        void execute(VkCommandBuffer);
+        void reset();
+
+        VkImage getImage(Resource resource) const { return resources[resource].image; }
+        VkImageView getImageView(Resource resource) const { return resources[resource].view; }
+        VkBuffer getBuffer(Resource resource) const { return resources[resource].buffer; }
+        bool isCulled(const std::string& passName) const;
+        VkDeviceSize getTransientMemorySize() const;
+        void setGpuProfiler(GpuProfiler gpuProfiler) { this->gpuProfiler = gpuProfiler; } //each executed pass becomes a GPU scope
+        void setDeletionQueue(DeletionQueue deletionQueue) { this->deletionQueue = deletionQueue; } //recompiling then frees transients once in-flight frames are done
+
+    private:
+        struct ResourceNode
+        {
+            std::string name;
+            bool transient;
+            bool isImage;
+            bool output{ false };
+            ImageDesc desc{};
+            VkImageAspectFlags aspect{ VK_IMAGE_ASPECT_COLOR_BIT };
+            ResourceState initialState{ ResourceState::Undefined };
+            ResourceState finalState{ ResourceState::Undefined };
+
+            VkImage image{ VK_NULL_HANDLE };
+            VkImageView view{ VK_NULL_HANDLE };
+            VkBuffer buffer{ VK_NULL_HANDLE };
+
+            uint32_t firstPass{ UINT32_MAX };
+            uint32_t lastPass{ 0 };
+            uint32_t memorySlot{ UINT32_MAX };
+            Resource previousOccupant{ UINT32_MAX }; //last resource to use the same memory before this one
+            ResourceState state{ ResourceState::Undefined }; //a transient keeps its state from the last execute, the next frame waits on it
+        };
+
+        //every access a pass makes to one resource, merged into the single state it is used in
+        struct Use
+        {
+            Resource resource;
+            ResourceState state;
+            bool read;
+            bool write;
+        };
+
+        //one allocation shared by every transient image placed in it, their lifetimes never overlap
+        struct MemorySlot
+        {
+            VmaAllocation allocation{};
+            VkMemoryRequirements requirements{};
+            uint32_t lastPass;
+            Resource lastOccupant;
+        };
+
+        Device device;
+        GpuProfiler gpuProfiler{ nullptr };
+        DeletionQueue deletionQueue{ nullptr };
+        std::vector<ResourceNode> resources;
+        std::vector<Pass> passes;
+        std::vector<MemorySlot> memorySlots;
+        bool compiled{ false };
+
+        std::vector<Use> mergeAccesses(const Pass&) const;
+        void cull();
+        void computeLifetimes();
+        void allocateTransients();
+        void releaseTransients(bool deferred = true);
+    };
+
+    //Named GPU scopes written as timestamp queries into one pool per frame slot, a slot's results are read back
+    //without waiting when the slot is recorded again, by then its previous frame has completed
+    class GpuProfiler_T
+    {
+    public:
+        struct ScopeStats
+        {
+            double lastMs{ 0 };
+            double averageMs{ 0 };
+            double minMs{ 0 };
+            double maxMs{ 0 };
+            uint32_t samples{ 0 }; //how many of the last HISTORY frames the averages cover
+        };
+
+        GpuProfiler_T(Device, uint32_t frameSlots, uint32_t maxScopes = 64);
+        ~GpuProfiler_T();
+
+        void init();
+        bool isSupported() const { return supported; }
+
+        //recorded outside any render pass, before the first scope of the frame
+        void beginFrame(VkCommandBuffer, uint32_t slot);
+        void beginScope(VkCommandBuffer, const std::string& name);
+        void endScope(VkCommandBuffer);
+
+        const std::unordered_map<std::string, ScopeStats>& getStats() const { return stats; }
+        //resolved scopes are kept as trace events while capturing, up to MAX_TRACE_EVENTS
+        void setTraceCapture(bool capture) { traceCapture = capture; }
+        void clearTrace() { traceEvents.clear(); }
+        void writeChromeTrace(const std::string& path) const;
+
+    private:
+        static constexpr uint32_t HISTORY{ 120 };
+        static constexpr size_t MAX_TRACE_EVENTS{ 200000 };
+
+        struct Scope
+        {
+            std::string name;
+            uint32_t query; //begin timestamp, the end one follows it
+        };
+        struct FrameQueries
+        {
+            VkQueryPool pool{ VK_NULL_HANDLE };
+            std::vector<Scope> scopes;
+            uint32_t usedQueries{ 0 };
+            uint64_t frameNumber{ 0 };
+        };
+        struct History
+        {
+            std::array<double, HISTORY> samples{};
+            uint32_t next{ 0 };
+            uint32_t count{ 0 };
+        };
+        struct TraceEvent
+        {
+            std::string name;
+            double startUs;
+            double durationUs;
+            uint64_t frameNumber;
+        };
+
+        Device device;
+        bool supported{ false };
+        uint32_t maxQueries;
+        double nsPerTick{ 1.0 };
+        uint64_t timestampMask{ ~0ull };
+
+        std::vector<FrameQueries> frames;
+        FrameQueries* recording{ nullptr };
+        std::vector<uint32_t> openScopes; //indices into recording->scopes, UINT32_MAX for scopes dropped when the pool was full
+        uint64_t frameCounter{ 0 };
+
+        std::unordered_map<std::string, History> history;
+        std::unordered_map<std::string, ScopeStats> stats;
+        bool traceCapture{ false };
+        std::vector<TraceEvent> traceEvents;
+        std::optional<uint64_t> traceOrigin;
+
+        void resolve(FrameQueries&);
+        void writeTimestamp(VkCommandBuffer, VkQueryPool, uint32_t query, bool end);
+    };
+
+}
+
+//CPU zones, MYR_PROFILE records them with CpuProfiler, MYR_PROFILE_TRACY forwards them to Tracy, otherwise they compile out
+#define MYR_PROFILE_CONCAT_INNER(a, b) a##b
+#define MYR_PROFILE_CONCAT(a, b) MYR_PROFILE_CONCAT_INNER(a, b)
+#if defined(MYR_PROFILE_TRACY)
+#include <tracy/Tracy.hpp>
+#define MYR_PROFILE_ZONE(name) ZoneScopedN(name)
+#define MYR_PROFILE_FUNCTION() ZoneScoped
+#define MYR_PROFILE_FRAME() FrameMark
+#elif defined(MYR_PROFILE)
+#define MYR_PROFILE_ZONE(name) MYR::CpuProfiler::ScopedZone MYR_PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define MYR_PROFILE_FUNCTION() MYR_PROFILE_ZONE(__func__)
+#define MYR_PROFILE_FRAME() MYR::CpuProfiler::markFrame()
+#else
+#define MYR_PROFILE_ZONE(name)
+#define MYR_PROFILE_FUNCTION()
+#define MYR_PROFILE_FRAME()
+#endif
\ No newline at end of file
@@ -1,27 +1,35 @@
 #include"MYR.h"
+#include"Shaders.h"
 #include <stdexcept>
 #include <iostream>
-#include <fstream>
+#include <algorithm>
 
 using namespace MYR;
 
-static std::vector<char> readFile(const std::string& filename);
-VkShaderModule createShaderModule(const std::vector<char>& code, Device device);
+VkShaderModule createShaderModule(const std::vector<uint32_t>& code, Device device);
 
-Pipeline_T::Pipeline_T(Device device) : device(device)
+Pipeline_T::Pipeline_T(Device device) : device(device),
+    vertShaderCode(std::begin(embeddedVertShader), std::end(embeddedVertShader)),
+    fragShaderCode(std::begin(embeddedFragShader), std::end(embeddedFragShader))
 {
 }
 
 Pipeline_T::~Pipeline_T()
 {
-    vkDestroyDescriptorSetLayout(device->getHandle(), descriptorSetLayout, nullptr);
-    vkDestroyPipeline(device->getHandle(), graphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(device->getHandle(), pipelineLayout, nullptr);
+    {
+        std::lock_guard<std::mutex> lock(compileMutex);
+        stopCompiling = true;
+    }
+    compileCondition.notify_all();
+    for (std::thread& worker : compileWorkers)
+        worker.join();
+
+    destroyPipelines();
     vkDestroyRenderPass(device->getHandle(), renderPass, nullptr);
 }
 
 //Graphics pipeline
-void Pipeline_T::initRenderPass(VkFormat ImageFormat)
+void Pipeline_T::initRenderPass(VkFormat ImageFormat, VkImageLayout finalLayout)
 {
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format = ImageFormat;
@@ -31,7 +39,7 @@ void Pipeline_T::initRenderPass(VkFormat ImageFormat)
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = finalLayout;
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -91,56 +99,379 @@ void Pipeline_T::initRenderPass(VkFormat ImageFormat)
 
 }
 
-void Pipeline_T::initDescriptorSetLayout()
+void Pipeline_T::initRenderingFormats(VkFormat colorFormat, VkFormat depthFormat)
+{
+    if (!device->supportsDynamicRendering())
+        throw std::runtime_error("failed to set rendering formats: dynamic rendering is not supported!");
+
+    dynamicRendering = true;
+    this->colorFormat = colorFormat;
+    this->depthFormat = depthFormat;
+}
+
+void Pipeline_T::initDescriptorSetLayout(DescriptorLayoutCache layoutCache)
+{
+    //set layouts and push constant ranges are reflected from the shaders, identical layouts are shared through the cache
+    ShaderReflection reflection = reflectShader(vertShaderCode, VK_SHADER_STAGE_VERTEX_BIT);
+    mergeReflection(reflection, reflectShader(fragShaderCode, VK_SHADER_STAGE_FRAGMENT_BIT));
+
+    //in bindless mode the shaders' declaration of that set is replaced by the shared table
+    uint32_t bindlessIndex = BindlessSet_T::SET_INDEX;
+    if (bindlessSet != nullptr && reflection.sets.size() <= bindlessIndex)
+        reflection.sets.resize(bindlessIndex + 1);
+
+    descriptorBindings = reflection.sets;
+    descriptorSetLayouts.clear();
+    for (uint32_t set = 0; set < descriptorBindings.size(); set++)
+    {
+        if (bindlessSet != nullptr && set == bindlessIndex)
+        {
+            descriptorBindings[set].clear(); //not allocated from the descriptor allocator
+            descriptorSetLayouts.push_back(bindlessSet->getLayout());
+        }
+        else
+            descriptorSetLayouts.push_back(layoutCache->getLayout(descriptorBindings[set]));
+    }
+
+    pushConstantRanges = reflection.pushConstantRanges;
+    reflected = true;
+    pushConstantBlock.setMaxSize(device->getProperties().limits.maxPushConstantsSize);
+    pushConstantBlock.setLayoutRanges(pushConstantRanges);
+    for (const PushConstantBlock::Entry& entry : pushConstantBlock.getEntries())
+        checkPushConstant(entry);
+}
+
+size_t Pipeline_T::addPushConstant(PushConstant pushConstant)
+{
+    //push constants registered before the device exists are validated once the layout is reflected
+    if (reflected)
+        checkPushConstant({ pushConstant.offset, pushConstant.size, pushConstant.stages });
+    return pushConstantBlock.add(pushConstant);
+}
+
+void Pipeline_T::checkPushConstant(const PushConstantBlock::Entry& pushConstant)
+{
+    for (uint32_t bit = 0; bit < 32; bit++)
+    {
+        VkShaderStageFlags stage = 1u << bit;
+        if (!(pushConstant.stages & stage)) continue;
+
+        bool covered = false;
+        for (VkPushConstantRange& range : pushConstantRanges)
+            if ((range.stageFlags & stage) && pushConstant.offset >= range.offset && pushConstant.offset + pushConstant.size <= range.offset + range.size)
+                covered = true;
+
+        if (!covered)
+            throw std::runtime_error("push constant is not declared by the shaders for its stages!");
+    }
+}
+
+std::vector<VkDescriptorPoolSize> Pipeline_T::getDescriptorPoolSizes(uint32_t setCount)
+{
+    std::unordered_map<VkDescriptorType, uint32_t> counts;
+    for (auto& bindings : descriptorBindings)
+        for (VkDescriptorSetLayoutBinding& binding : bindings)
+            counts[binding.descriptorType] += binding.descriptorCount * setCount;
+
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (auto& kv : counts)
+        if (kv.second > 0)
+            poolSizes.push_back({ kv.first, kv.second });
+    return poolSizes;
+}
+
+void Pipeline_T::setShaderCode(const uint32_t* vertCode, size_t vertSize, const uint32_t* fragCode, size_t fragSize)
 {
-    std::vector<VkDescriptorSetLayoutBinding> layoutBindings{ 1 };
+    vertShaderCode.assign(vertCode, vertCode + vertSize / sizeof(uint32_t));
+    fragShaderCode.assign(fragCode, fragCode + fragSize / sizeof(uint32_t));
+}
 
-    VkDescriptorSetLayoutBinding uboLayoutBinding{};
-    layoutBindings[0].binding = 0;
-    layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    layoutBindings[0].descriptorCount = 1;
-    layoutBindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-    layoutBindings[0].pImmutableSamplers = nullptr;
+#ifdef MYR_RUNTIME_SHADERS
+void Pipeline_T::setShaderSources(ShaderCompiler shaderCompiler, const ShaderSource& vert, const ShaderSource& frag, bool hotReload)
+{
+    std::vector<std::string> dependencies;
+    vertShaderCode = shaderCompiler->compile(vert, &dependencies);
+    fragShaderCode = shaderCompiler->compile(frag, &dependencies);
+
+    if (!hotReload) return;
+
+    //called on the compiler's watcher thread, a compile worker builds the pipeline and reloadShaders swaps it in on the render thread
+    shaderCompiler->watch({ vert, frag }, dependencies, [this](std::vector<std::vector<uint32_t>>& code)
+        {
+            {
+                std::lock_guard<std::mutex> lock(compileMutex);
+                pendingVertShaderCode = std::move(code[0]);
+                pendingFragShaderCode = std::move(code[1]);
+                reloadQueued = true;
+                startCompileWorkers();
+            }
+            compileCondition.notify_one();
+        });
+}
+#endif
 
-    VkDescriptorSetLayoutCreateInfo layoutInfo{};
-    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = layoutBindings.size();
-    layoutInfo.pBindings = layoutBindings.data();
+bool Pipeline_T::reloadShaders()
+{
+    if (!reloadPending) return false;
 
-    if (vkCreateDescriptorSetLayout(device->getHandle(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
-        throw std::runtime_error("failed to create descriptor set layout!");
+    //only handles are swapped here, the modules and default pipeline were built by a compile worker
+    std::vector<VkPipeline> replaced;
+    {
+        std::lock_guard<std::mutex> lock(compileMutex);
+        for (auto it = pipelines.begin(); it != pipelines.end();)
+        {
+            if (it->second != VK_NULL_HANDLE)
+            {
+                replaced.push_back(it->second);
+                it = pipelines.erase(it);
+            }
+            else
+                it++;
+        }
+
+        //variants other than the default are recompiled on their next request, the descriptor interface is assumed unchanged
+        pipelines[PipelineState{}] = pendingPipeline;
+        graphicsPipeline = pendingPipeline;
+        retiredShaderModules.push_back(vertShaderModule);
+        retiredShaderModules.push_back(fragShaderModule);
+        vertShaderModule = pendingVertShaderModule;
+        fragShaderModule = pendingFragShaderModule;
+        pendingPipeline = VK_NULL_HANDLE;
+        pendingVertShaderModule = VK_NULL_HANDLE;
+        pendingFragShaderModule = VK_NULL_HANDLE;
+        shaderGeneration++;
+        reloadPending = false;
+        if (activeCompiles == 0)
+            destroyRetiredModules();
+    }
 
+    //frames in flight may still be bound to the old pipelines
+    if (deletionQueue != nullptr)
+        deletionQueue->push([device = device, replaced]()
+            {
+                for (VkPipeline oldPipeline : replaced)
+                    vkDestroyPipeline(device->getHandle(), oldPipeline, nullptr);
+            });
+    else
+    {
+        vkDeviceWaitIdle(device->getHandle());
+        for (VkPipeline oldPipeline : replaced)
+            vkDestroyPipeline(device->getHandle(), oldPipeline, nullptr);
+    }
+    return true;
 }
 
-void Pipeline_T::addPushConstant(PushConstant pushConstant)
+void Pipeline_T::buildReload(std::vector<uint32_t> vertCode, std::vector<uint32_t> fragCode)
 {
-    pushConstants.push_back(pushConstant);
+    VkShaderModule newVertModule = createShaderModule(vertCode, device);
+    VkShaderModule newFragModule = VK_NULL_HANDLE;
+    VkPipeline newPipeline = VK_NULL_HANDLE;
+    try
+    {
+        newFragModule = createShaderModule(fragCode, device);
+        newPipeline = createPipeline(PipelineState{}, newVertModule, newFragModule);
+    }
+    catch (...)
+    {
+        vkDestroyShaderModule(device->getHandle(), newFragModule, nullptr);
+        vkDestroyShaderModule(device->getHandle(), newVertModule, nullptr);
+        throw;
+    }
 
-    VkPushConstantRange range = {};
-    range.stageFlags = pushConstant.stages;
-    range.offset = pushConstant.offset;
-    range.size = pushConstant.size;
+    std::lock_guard<std::mutex> lock(compileMutex);
+    destroyPendingReload(); //a newer edit supersedes a reload that was never swapped in
+    pendingVertShaderModule = newVertModule;
+    pendingFragShaderModule = newFragModule;
+    pendingPipeline = newPipeline;
+    vertShaderCode = std::move(vertCode);
+    fragShaderCode = std::move(fragCode);
+    reloadPending = true;
+}
 
-    pushConstantRanges.push_back(range);
+void Pipeline_T::destroyPendingReload()
+{
+    vkDestroyPipeline(device->getHandle(), pendingPipeline, nullptr);
+    vkDestroyShaderModule(device->getHandle(), pendingFragShaderModule, nullptr);
+    vkDestroyShaderModule(device->getHandle(), pendingVertShaderModule, nullptr);
+    pendingPipeline = VK_NULL_HANDLE;
+    pendingFragShaderModule = VK_NULL_HANDLE;
+    pendingVertShaderModule = VK_NULL_HANDLE;
+    reloadPending = false;
+}
+
+void Pipeline_T::destroyRetiredModules()
+{
+    //pipelines keep working after their modules are destroyed, only an in-progress vkCreateGraphicsPipelines needs them
+    for (VkShaderModule module : retiredShaderModules)
+        vkDestroyShaderModule(device->getHandle(), module, nullptr);
+    retiredShaderModules.clear();
 }
 
 void Pipeline_T::initGraphicsPipeline()
 {
-    auto vertShaderCode = readFile("vert.spv");
-    auto fragShaderCode = readFile("frag.spv");
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode,device);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode,device);
+    vertShaderModule = createShaderModule(vertShaderCode,device);
+    fragShaderModule = createShaderModule(fragShaderCode,device);
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    if (vkCreatePipelineCache(device->getHandle(), &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+        throw std::runtime_error("failed to create pipeline cache!");
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+    pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+    if (vkCreatePipelineLayout(device->getHandle(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create pipeline layout!");
+    }
+
+    graphicsPipeline = getPipeline(PipelineState{});
+}
+
+VkPipeline Pipeline_T::getPipeline(const PipelineState& state)
+{
+    {
+        std::lock_guard<std::mutex> lock(compileMutex);
+        auto found = pipelines.find(state);
+        if (found != pipelines.end() && found->second != VK_NULL_HANDLE)
+            return found->second;
+    }
+
+    //the render thread is the only one that swaps modules, so they can be read here without the lock
+    return storePipeline(state, createPipeline(state, vertShaderModule, fragShaderModule), shaderGeneration);
+}
+
+VkPipeline Pipeline_T::requestPipeline(const PipelineState& state)
+{
+    std::unique_lock<std::mutex> lock(compileMutex);
+    auto found = pipelines.find(state);
+    if (found != pipelines.end() && found->second != VK_NULL_HANDLE)
+        return found->second;
+
+    if (found == pipelines.end())
+    {
+        //a null entry marks the variant as queued so it is only compiled once
+        pipelines[state] = VK_NULL_HANDLE;
+        compileQueue.push_back(state);
+        startCompileWorkers();
+        lock.unlock();
+        compileCondition.notify_one();
+    }
+
+    return useFallbackPipeline ? graphicsPipeline : VK_NULL_HANDLE;
+}
+
+//expects compileMutex to be held
+void Pipeline_T::startCompileWorkers()
+{
+    if (!compileWorkers.empty() || stopCompiling)
+        return;
+
+    unsigned int workerCount = std::clamp(std::thread::hardware_concurrency() / 2, 1u, 4u);
+    for (unsigned int i = 0; i < workerCount; i++)
+        compileWorkers.emplace_back(&Pipeline_T::compileLoop, this);
+}
+
+void Pipeline_T::compileLoop()
+{
+    while (true)
+    {
+        bool reload = false;
+        std::vector<uint32_t> vertCode;
+        std::vector<uint32_t> fragCode;
+        PipelineState state;
+        VkShaderModule vertModule{ VK_NULL_HANDLE };
+        VkShaderModule fragModule{ VK_NULL_HANDLE };
+        uint32_t generation{ 0 };
+        {
+            std::unique_lock<std::mutex> lock(compileMutex);
+            compileCondition.wait(lock, [this] { return stopCompiling || reloadQueued || !compileQueue.empty(); });
+            if (stopCompiling)
+                return;
+
+            if (reloadQueued)
+            {
+                reload = true;
+                reloadQueued = false;
+                vertCode = std::move(pendingVertShaderCode);
+                fragCode = std::move(pendingFragShaderCode);
+            }
+            else
+            {
+                state = compileQueue.front();
+                compileQueue.pop_front();
+                vertModule = vertShaderModule;
+                fragModule = fragShaderModule;
+                generation = shaderGeneration;
+            }
+            activeCompiles++;
+        }
+
+        try
+        {
+            if (reload)
+                buildReload(std::move(vertCode), std::move(fragCode));
+            else
+                storePipeline(state, createPipeline(state, vertModule, fragModule), generation);
+        }
+        catch (const std::exception& e)
+        {
+            //leave the null entry in place, draws keep using the fallback instead of retrying every frame
+            std::cerr << (reload ? "shader reload: " : "async pipeline compile: ") << e.what() << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(compileMutex);
+            activeCompiles--;
+            if (activeCompiles == 0)
+                destroyRetiredModules();
+        }
+        compileIdleCondition.notify_all();
+    }
+}
+
+void Pipeline_T::waitForCompiles()
+{
+    std::unique_lock<std::mutex> lock(compileMutex);
+    compileIdleCondition.wait(lock, [this] { return !reloadQueued && compileQueue.empty() && activeCompiles == 0; });
+}
+
+VkPipeline Pipeline_T::storePipeline(const PipelineState& state, VkPipeline newPipeline, uint32_t generation)
+{
+    std::lock_guard<std::mutex> lock(compileMutex);
+    //built from modules a reload has replaced, the variant is compiled again on its next request
+    if (generation != shaderGeneration)
+    {
+        vkDestroyPipeline(device->getHandle(), newPipeline, nullptr);
+        auto found = pipelines.find(state);
+        if (found != pipelines.end() && found->second == VK_NULL_HANDLE)
+            pipelines.erase(found);
+        return VK_NULL_HANDLE;
+    }
 
+    VkPipeline& stored = pipelines[state];
+    if (stored != VK_NULL_HANDLE) //built concurrently by getPipeline and a worker, keep the first
+        vkDestroyPipeline(device->getHandle(), newPipeline, nullptr);
+    else
+        stored = newPipeline;
+    return stored;
+}
+
+VkPipeline Pipeline_T::createPipeline(const PipelineState& state, VkShaderModule vertModule, VkShaderModule fragModule)
+{
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.module = vertModule;
     vertShaderStageInfo.pName = "main";
 
     VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
     fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
+    fragShaderStageInfo.module = fragModule;
     fragShaderStageInfo.pName = "main";
 
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
@@ -171,16 +502,17 @@ void Pipeline_T::initGraphicsPipeline()
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;//Draw triangles
+    inputAssembly.topology = state.topology;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
     rasterizer.depthClampEnable = VK_FALSE;
     rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    //LINE and POINT need fillModeNonSolid, devices without it draw the variant filled
+    rasterizer.polygonMode = device->getCapabilities().fillModeNonSolid ? state.polygonMode : VK_POLYGON_MODE_FILL;
     rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.cullMode = state.cullMode;
     rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
     rasterizer.depthBiasEnable = VK_FALSE;
     rasterizer.depthBiasConstantFactor = 0.0f;
@@ -198,7 +530,7 @@ void Pipeline_T::initGraphicsPipeline()
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
+    colorBlendAttachment.blendEnable = state.blendEnable;
     colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
     colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
     colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
@@ -222,22 +554,11 @@ void Pipeline_T::initGraphicsPipeline()
     colorBlending.attachmentCount = 1;
     colorBlending.pAttachments = &colorBlendAttachment;
 
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
-    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
-
-    if (vkCreatePipelineLayout(device->getHandle(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create pipeline layout!");
-    }
-
     VkPipelineDepthStencilStateCreateInfo depthStencil{};
     depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthTestEnable = state.depthTestEnable;
+    depthStencil.depthWriteEnable = state.depthWriteEnable;
+    depthStencil.depthCompareOp = state.depthCompareOp;
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.minDepthBounds = 0.0f;
     depthStencil.maxDepthBounds = 1.0f; 
@@ -245,9 +566,17 @@ void Pipeline_T::initGraphicsPipeline()
     depthStencil.front = {}; 
     depthStencil.back = {}; 
 
-    depthStencil.depthWriteEnable = VK_TRUE;
+    //only the depth aspect is attached when rendering dynamically, so no stencil format is declared
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &colorFormat;
+    renderingInfo.depthAttachmentFormat = depthFormat;
+
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    if (dynamicRendering)
+        pipelineInfo.pNext = &renderingInfo;
     pipelineInfo.stageCount = 2;
     pipelineInfo.pStages = shaderStages;
     pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -264,40 +593,52 @@ void Pipeline_T::initGraphicsPipeline()
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device->getHandle(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+    VkPipeline newPipeline;
+    if (vkCreateGraphicsPipelines(device->getHandle(), pipelineCache, 1, &pipelineInfo, nullptr, &newPipeline) != VK_SUCCESS)
     {
         throw std::runtime_error("failed to create graphics pipeline!");
     }
 
+    return newPipeline;
+}
+
+void Pipeline_T::destroyPipelines()
+{
+    for (auto& kv : pipelines)
+        vkDestroyPipeline(device->getHandle(), kv.second, nullptr);
+    pipelines.clear();
+    graphicsPipeline = VK_NULL_HANDLE;
+
+    destroyPendingReload();
+    destroyRetiredModules();
+    vkDestroyPipelineCache(device->getHandle(), pipelineCache, nullptr);
     vkDestroyShaderModule(device->getHandle(), fragShaderModule, nullptr);
     vkDestroyShaderModule(device->getHandle(), vertShaderModule, nullptr);
+    vkDestroyPipelineLayout(device->getHandle(), pipelineLayout, nullptr);
 }
 
-
-
-static std::vector<char> readFile(const std::string& filename)
+size_t PipelineStateHash::operator()(const PipelineState& state) const
 {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);//open as binary and start read from back (so as to get the length)
+    size_t hash = 0;
+    auto combine = [&hash](size_t value) { hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2); };
+    combine(state.topology);
+    combine(state.polygonMode);
+    combine(state.cullMode);
+    combine(state.blendEnable);
+    combine(state.depthTestEnable);
+    combine(state.depthWriteEnable);
+    combine(state.depthCompareOp);
+    return hash;
+}
 
-    if (!file.is_open())
-    {
-        throw std::runtime_error("failed to open file!");
-    }
 
-    size_t fileSize = static_cast<size_t>(file.tellg());
-    std::vector<char> buffer(fileSize);
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
 
-    return buffer;
-}
-VkShaderModule createShaderModule(const std::vector<char>& code, Device device)
+VkShaderModule createShaderModule(const std::vector<uint32_t>& code, Device device)
 {
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    createInfo.codeSize = code.size() * sizeof(uint32_t);
+    createInfo.pCode = code.data();
 
     VkShaderModule shaderModule;
     if (vkCreateShaderModule(device->getHandle(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
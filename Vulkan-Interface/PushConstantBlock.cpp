@@ -0,0 +1,106 @@
+#include "MYR.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace MYR;
+
+size_t PushConstantBlock::add(const PushConstant& pushConstant)
+{
+    if (pushConstant.offset % 4 != 0 || pushConstant.size % 4 != 0 || pushConstant.size == 0)
+        throw std::invalid_argument("push constant offset and size must be non-zero multiples of 4!");
+    if (maxSize != 0 && pushConstant.offset + pushConstant.size > maxSize)
+        throw std::runtime_error("push constant exceeds maxPushConstantsSize!");
+
+    entries.push_back({ pushConstant.offset, pushConstant.size, pushConstant.stages });
+
+    uint32_t end = pushConstant.offset + pushConstant.size;
+    if (shadow.size() * sizeof(uint32_t) < end)
+        shadow.resize(end / sizeof(uint32_t), 0);
+    if (pushConstant.data != nullptr)
+        write(pushConstant.offset, pushConstant.size, pushConstant.data);
+
+    buildSegments();
+    return entries.size() - 1;
+}
+
+void PushConstantBlock::setMaxSize(uint32_t maxPushConstantsSize)
+{
+    maxSize = maxPushConstantsSize;
+    for (Entry& entry : entries)
+        if (entry.offset + entry.size > maxSize)
+            throw std::runtime_error("push constant exceeds maxPushConstantsSize!");
+}
+
+void PushConstantBlock::setLayoutRanges(const std::vector<VkPushConstantRange>& ranges)
+{
+    layoutRanges = ranges;
+    buildSegments();
+}
+
+void PushConstantBlock::set(size_t index, const void* data)
+{
+    if (index >= entries.size())
+        throw std::out_of_range("push constant index is not registered!");
+    write(entries[index].offset, entries[index].size, data);
+}
+
+void PushConstantBlock::flush(VkCommandBuffer commandBuffer, VkPipelineLayout layout)
+{
+    //no dirty tracking, the command buffer is reset every frame so every segment has to be pushed again anyway
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(shadow.data());
+    for (Segment& segment : segments)
+        vkCmdPushConstants(commandBuffer, layout, segment.stages, segment.offset, segment.size, bytes + segment.offset);
+}
+
+void PushConstantBlock::write(uint32_t offset, uint32_t size, const void* data)
+{
+    memcpy(reinterpret_cast<uint8_t*>(shadow.data()) + offset, data, size);
+}
+
+void PushConstantBlock::buildSegments()
+{
+    //every entry and layout range edge is a boundary, between two boundaries the covering stages cannot change
+    std::vector<uint32_t> boundaries;
+    for (Entry& entry : entries)
+    {
+        boundaries.push_back(entry.offset);
+        boundaries.push_back(entry.offset + entry.size);
+    }
+    for (VkPushConstantRange& range : layoutRanges)
+    {
+        boundaries.push_back(range.offset);
+        boundaries.push_back(range.offset + range.size);
+    }
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    segments.clear();
+    for (size_t i = 0; i + 1 < boundaries.size(); i++)
+    {
+        uint32_t begin = boundaries[i];
+        uint32_t end = boundaries[i + 1];
+
+        VkShaderStageFlags entryStages = 0;
+        for (Entry& entry : entries)
+            if (entry.offset < end && begin < entry.offset + entry.size)
+                entryStages |= entry.stages;
+        if (entryStages == 0) continue; //no registered data here
+
+        //a push must name exactly the stages of the layout ranges that contain its bytes, bytes outside every range are not consumed
+        VkShaderStageFlags stages = entryStages;
+        if (!layoutRanges.empty())
+        {
+            stages = 0;
+            for (VkPushConstantRange& range : layoutRanges)
+                if (range.offset <= begin && end <= range.offset + range.size)
+                    stages |= range.stageFlags;
+            if (stages == 0) continue;
+        }
+
+        //adjacent pieces with the same stages go out in one call
+        if (!segments.empty() && segments.back().offset + segments.back().size == begin && segments.back().stages == stages)
+            segments.back().size = end - segments.back().offset;
+        else
+            segments.push_back({ begin, end - begin, stages });
+    }
+}
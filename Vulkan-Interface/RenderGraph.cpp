@@ -0,0 +1,400 @@
+#include "MYR.h"
+#include <algorithm>
+
+using namespace MYR;
+
+namespace
+{
+    bool isWrite(ResourceState state)
+    {
+        switch (state)
+        {
+        case ResourceState::TransferDst:
+        case ResourceState::ComputeShaderWrite:
+        case ResourceState::ColorAttachment:
+        case ResourceState::DepthAttachment:
+        case ResourceState::HostWrite:
+            return true;
+        default:
+            return false;
+        }
+    }
+}
+
+RenderGraph_T::Pass& RenderGraph_T::Pass::read(Resource resource, ResourceState state)
+{
+    accesses.push_back({ resource, state, false });
+    return *this;
+}
+
+RenderGraph_T::Pass& RenderGraph_T::Pass::write(Resource resource, ResourceState state)
+{
+    accesses.push_back({ resource, state, true });
+    return *this;
+}
+
+RenderGraph_T::RenderGraph_T(Device device) : device(device) {}
+
+RenderGraph_T::~RenderGraph_T()
+{
+    releaseTransients(false);
+}
+
+RenderGraph_T::Resource RenderGraph_T::createImage(const std::string& name, const ImageDesc& desc)
+{
+    ResourceNode node{};
+    node.name = name;
+    node.transient = true;
+    node.isImage = true;
+    node.desc = desc;
+    node.aspect = desc.aspect;
+    resources.push_back(node);
+    compiled = false;
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph_T::Resource RenderGraph_T::importImage(const std::string& name, VkImageAspectFlags aspect, ResourceState initialState, ResourceState finalState)
+{
+    ResourceNode node{};
+    node.name = name;
+    node.transient = false;
+    node.isImage = true;
+    node.aspect = aspect;
+    node.initialState = initialState;
+    node.finalState = finalState;
+    node.output = finalState != initialState; //something outside the graph expects it in its final state
+    resources.push_back(node);
+    compiled = false;
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+RenderGraph_T::Resource RenderGraph_T::importBuffer(const std::string& name, ResourceState initialState, ResourceState finalState)
+{
+    ResourceNode node{};
+    node.name = name;
+    node.transient = false;
+    node.isImage = false;
+    node.initialState = initialState;
+    node.finalState = finalState;
+    node.output = finalState != initialState;
+    resources.push_back(node);
+    compiled = false;
+    return static_cast<Resource>(resources.size() - 1);
+}
+
+void RenderGraph_T::setImage(Resource resource, VkImage image, VkImageView view)
+{
+    if (resources[resource].transient)
+        throw std::runtime_error("failed to set image: " + resources[resource].name + " is owned by the render graph!");
+    resources[resource].image = image;
+    resources[resource].view = view;
+}
+
+void RenderGraph_T::setBuffer(Resource resource, VkBuffer buffer)
+{
+    resources[resource].buffer = buffer;
+}
+
+void RenderGraph_T::markOutput(Resource resource)
+{
+    resources[resource].output = true;
+    compiled = false;
+}
+
+RenderGraph_T::Pass& RenderGraph_T::addPass(const std::string& name, PassCallback callback)
+{
+    Pass pass{};
+    pass.name = name;
+    pass.callback = std::move(callback);
+    passes.push_back(std::move(pass));
+    compiled = false;
+    return passes.back();
+}
+
+void RenderGraph_T::compile()
+{
+    releaseTransients();
+    cull();
+    computeLifetimes();
+    allocateTransients();
+    compiled = true;
+}
+
+void RenderGraph_T::execute(VkCommandBuffer commandBuffer)
+{
+    if (!compiled)
+        compile();
+
+    //imported resources start where the caller left them, transients keep the state the previous frame left them in
+    for (ResourceNode& node : resources)
+        if (!node.transient)
+            node.state = node.initialState;
+
+    std::vector<bool> used(resources.size(), false);
+    BarrierBatch barriers(device);
+    for (uint32_t passIndex = 0; passIndex < passes.size(); passIndex++)
+    {
+        Pass& pass = passes[passIndex];
+        if (pass.culled)
+            continue;
+
+        for (Use& use : mergeAccesses(pass))
+        {
+            ResourceNode& node = resources[use.resource];
+
+            //transient contents never survive a frame, but the first use has to wait for whatever used the memory last,
+            //an earlier image in this frame or the slot's last image in the previous frame, which may still be in flight
+            if (node.transient && !used[use.resource])
+            {
+                Resource holder = node.previousOccupant != UINT32_MAX ? node.previousOccupant : memorySlots[node.memorySlot].lastOccupant;
+                barriers.alias(node.image, node.aspect, resources[holder].state, use.state);
+            }
+            //an image that is only written (cleared or fully overwritten) drops its old contents, that skips the layout preserve
+            else if (node.isImage && use.write && !use.read)
+                barriers.alias(node.image, node.aspect, node.state, use.state);
+            //read after read in the same state is the only case that needs no barrier
+            else if (node.state != use.state || isWrite(use.state))
+            {
+                if (node.isImage)
+                    barriers.transition(node.image, node.aspect, node.state, use.state);
+                else
+                    barriers.transition(node.buffer, node.state, use.state);
+            }
+            node.state = use.state;
+            used[use.resource] = true;
+        }
+        barriers.flush(commandBuffer);
+
+        if (gpuProfiler != nullptr)
+            gpuProfiler->beginScope(commandBuffer, pass.name);
+        pass.callback(commandBuffer, *this);
+        if (gpuProfiler != nullptr)
+            gpuProfiler->endScope(commandBuffer);
+    }
+
+    for (ResourceNode& node : resources)
+    {
+        if (node.transient || node.state == node.finalState || node.finalState == ResourceState::Undefined)
+            continue;
+        if (node.isImage)
+            barriers.transition(node.image, node.aspect, node.state, node.finalState);
+        else
+            barriers.transition(node.buffer, node.state, node.finalState);
+        node.state = node.finalState;
+    }
+    barriers.flush(commandBuffer);
+}
+
+std::vector<RenderGraph_T::Use> RenderGraph_T::mergeAccesses(const Pass& pass) const
+{
+    //one barrier per resource and pass, a resource that is read and written (load op LOAD) takes the write state
+    std::vector<Use> uses;
+    for (const Pass::Access& access : pass.accesses)
+    {
+        auto found = std::find_if(uses.begin(), uses.end(), [&access](const Use& use) { return use.resource == access.resource; });
+        if (found == uses.end())
+        {
+            uses.push_back({ access.resource, access.state, !access.write, access.write });
+            continue;
+        }
+
+        if (access.write && !found->write)
+            found->state = access.state;
+        else if (access.write == found->write && access.state != found->state)
+            throw std::runtime_error("failed to execute pass " + pass.name + ": it uses " + resources[access.resource].name + " in two states!");
+        found->read = found->read || !access.write;
+        found->write = found->write || access.write;
+    }
+    return uses;
+}
+
+void RenderGraph_T::reset()
+{
+    releaseTransients();
+    passes.clear();
+    resources.clear();
+    compiled = false;
+}
+
+bool RenderGraph_T::isCulled(const std::string& passName) const
+{
+    for (const Pass& pass : passes)
+        if (pass.name == passName)
+            return pass.culled;
+    return false;
+}
+
+VkDeviceSize RenderGraph_T::getTransientMemorySize() const
+{
+    VkDeviceSize size = 0;
+    for (const MemorySlot& slot : memorySlots)
+        size += slot.requirements.size;
+    return size;
+}
+
+void RenderGraph_T::cull()
+{
+    //walk the passes backwards, a pass survives when something later (or outside the graph) needs what it writes
+    std::vector<bool> needed(resources.size(), false);
+    for (size_t i = 0; i < resources.size(); i++)
+        needed[i] = resources[i].output;
+
+    for (size_t i = passes.size(); i-- > 0;)
+    {
+        Pass& pass = passes[i];
+        pass.culled = !pass.keep;
+        for (Pass::Access& access : pass.accesses)
+            if (access.write && needed[access.resource])
+                pass.culled = false;
+
+        if (pass.culled)
+            continue;
+        for (Pass::Access& access : pass.accesses)
+            if (!access.write)
+                needed[access.resource] = true;
+    }
+}
+
+void RenderGraph_T::computeLifetimes()
+{
+    for (ResourceNode& node : resources)
+    {
+        node.firstPass = UINT32_MAX;
+        node.lastPass = 0;
+        node.memorySlot = UINT32_MAX;
+        node.previousOccupant = UINT32_MAX;
+        if (node.transient)
+            node.state = ResourceState::Undefined; //new memory, no earlier frame to wait on
+    }
+
+    for (uint32_t passIndex = 0; passIndex < passes.size(); passIndex++)
+    {
+        if (passes[passIndex].culled)
+            continue;
+        for (Pass::Access& access : passes[passIndex].accesses)
+        {
+            ResourceNode& node = resources[access.resource];
+            node.firstPass = std::min(node.firstPass, passIndex);
+            node.lastPass = std::max(node.lastPass, passIndex);
+        }
+    }
+}
+
+void RenderGraph_T::allocateTransients()
+{
+    std::vector<Resource> order;
+    std::vector<VkMemoryRequirements> requirements(resources.size());
+    for (Resource resource = 0; resource < resources.size(); resource++)
+    {
+        ResourceNode& node = resources[resource];
+        if (!node.transient || node.firstPass == UINT32_MAX)
+            continue;
+
+        //created without memory, it is bound into a shared slot below
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = { node.desc.width, node.desc.height, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = node.desc.format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = node.desc.usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device->getHandle(), &imageInfo, nullptr, &node.image) != VK_SUCCESS)
+            throw std::runtime_error("failed to create render graph image " + node.name + "!");
+        vkGetImageMemoryRequirements(device->getHandle(), node.image, &requirements[resource]);
+        order.push_back(resource);
+    }
+
+    //first fit in order of first use, a slot is free again once the pass that last touched its occupant has run
+    std::sort(order.begin(), order.end(), [this](Resource a, Resource b) { return resources[a].firstPass < resources[b].firstPass; });
+    for (Resource resource : order)
+    {
+        ResourceNode& node = resources[resource];
+        const VkMemoryRequirements& required = requirements[resource];
+
+        for (uint32_t i = 0; i < memorySlots.size(); i++)
+        {
+            MemorySlot& slot = memorySlots[i];
+            if (slot.lastPass < node.firstPass && (slot.requirements.memoryTypeBits & required.memoryTypeBits) != 0)
+            {
+                node.memorySlot = i;
+                node.previousOccupant = slot.lastOccupant;
+                slot.requirements.size = std::max(slot.requirements.size, required.size);
+                slot.requirements.alignment = std::max(slot.requirements.alignment, required.alignment);
+                slot.requirements.memoryTypeBits &= required.memoryTypeBits;
+                slot.lastPass = node.lastPass;
+                slot.lastOccupant = resource;
+                break;
+            }
+        }
+
+        if (node.memorySlot == UINT32_MAX)
+        {
+            node.memorySlot = static_cast<uint32_t>(memorySlots.size());
+            memorySlots.push_back({ VmaAllocation{}, required, node.lastPass, resource });
+        }
+    }
+
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    for (MemorySlot& slot : memorySlots)
+        if (vmaAllocateMemory(device->getAllocator(), &slot.requirements, &allocInfo, &slot.allocation, nullptr) != VK_SUCCESS)
+            throw std::runtime_error("failed to allocate render graph memory!");
+
+    for (Resource resource : order)
+    {
+        ResourceNode& node = resources[resource];
+        if (vmaBindImageMemory(device->getAllocator(), memorySlots[node.memorySlot].allocation, node.image) != VK_SUCCESS)
+            throw std::runtime_error("failed to bind render graph image " + node.name + "!");
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = node.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = node.desc.format;
+        viewInfo.subresourceRange = { node.aspect, 0, 1, 0, 1 };
+        if (vkCreateImageView(device->getHandle(), &viewInfo, nullptr, &node.view) != VK_SUCCESS)
+            throw std::runtime_error("failed to create render graph image view " + node.name + "!");
+    }
+}
+
+void RenderGraph_T::releaseTransients(bool deferred)
+{
+    std::vector<VkImageView> views;
+    std::vector<VkImage> images;
+    std::vector<VmaAllocation> allocations;
+    for (ResourceNode& node : resources)
+    {
+        if (!node.transient || node.image == VK_NULL_HANDLE)
+            continue;
+        views.push_back(node.view);
+        images.push_back(node.image);
+        node.view = VK_NULL_HANDLE;
+        node.image = VK_NULL_HANDLE;
+    }
+    for (MemorySlot& slot : memorySlots)
+        allocations.push_back(slot.allocation);
+    memorySlots.clear();
+
+    //frames recorded against the previous compilation may still be executing, so the images wait for the deletion queue
+    VkDevice handle = device->getHandle();
+    VmaAllocator allocator = device->getAllocator();
+    auto destroy = [handle, allocator, views, images, allocations]()
+    {
+        for (VkImageView view : views)
+            vkDestroyImageView(handle, view, nullptr);
+        for (VkImage image : images)
+            vkDestroyImage(handle, image, nullptr);
+        for (VmaAllocation allocation : allocations)
+            vmaFreeMemory(allocator, allocation);
+    };
+    if (deferred && deletionQueue != nullptr)
+        deletionQueue->push(destroy);
+    else
+        destroy();
+}
@@ -0,0 +1,303 @@
+#include "MYR.h"
+
+#ifdef MYR_RUNTIME_SHADERS
+#include <shaderc/shaderc.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <set>
+#include <chrono>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace MYR;
+
+static std::string readTextFile(const std::filesystem::path& path);
+static uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+// Resolves #include relative to the including file and remembers every file it opened, so the watcher also reacts to header edits
+class FileIncluder : public shaderc::CompileOptions::IncluderInterface
+{
+public:
+    FileIncluder(std::set<std::filesystem::path>* dependencies) : dependencies(dependencies) {}
+
+    shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type type, const char* requestingSource, size_t includeDepth) override
+    {
+        std::filesystem::path path{ requestedSource };
+        if (type == shaderc_include_type_relative)
+            path = std::filesystem::path(requestingSource).parent_path() / path;
+
+        auto* include = new IncludeData{};
+        if (std::filesystem::exists(path))
+        {
+            include->name = std::filesystem::absolute(path).string();
+            include->content = readTextFile(path);
+            dependencies->insert(std::filesystem::absolute(path));
+        }
+        else
+            include->content = "failed to find include file: " + path.string(); // an empty name reports an error to shaderc
+
+        include->result.source_name = include->name.c_str();
+        include->result.source_name_length = include->name.size();
+        include->result.content = include->content.c_str();
+        include->result.content_length = include->content.size();
+        include->result.user_data = include;
+        return &include->result;
+    }
+
+    void ReleaseInclude(shaderc_include_result* data) override
+    {
+        delete static_cast<IncludeData*>(data->user_data);
+    }
+
+private:
+    struct IncludeData
+    {
+        std::string name;
+        std::string content;
+        shaderc_include_result result;
+    };
+
+    std::set<std::filesystem::path>* dependencies;
+};
+
+
+ShaderCompiler_T::ShaderCompiler_T(const std::string& cacheDirectory) : cacheDirectory(cacheDirectory)
+{
+    std::filesystem::create_directories(cacheDirectory);
+}
+
+ShaderCompiler_T::~ShaderCompiler_T()
+{
+    running = false;
+    if (watcher.joinable())
+        watcher.join();
+}
+
+std::vector<uint32_t> ShaderCompiler_T::compile(const ShaderSource& shader, std::vector<std::string>* dependencies)
+{
+    shaderc_shader_kind kind;
+    switch (shader.stage)
+    {
+    case VK_SHADER_STAGE_VERTEX_BIT:
+        kind = shaderc_vertex_shader;
+        break;
+    case VK_SHADER_STAGE_FRAGMENT_BIT:
+        kind = shaderc_fragment_shader;
+        break;
+    case VK_SHADER_STAGE_COMPUTE_BIT:
+        kind = shaderc_compute_shader;
+        break;
+    default:
+        throw std::invalid_argument("unsupported shader stage!");
+    }
+
+    std::set<std::filesystem::path> includes{ std::filesystem::absolute(shader.path) };
+    std::string source = readTextFile(shader.path);
+
+    shaderc::Compiler compiler;
+    shaderc::CompileOptions options;
+    options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_1);
+    options.SetOptimizationLevel(shaderc_optimization_level_performance);
+    options.SetIncluder(std::make_unique<FileIncluder>(&includes));
+    for (auto& define : shader.defines)
+        options.AddMacroDefinition(define.first, define.second);
+
+    //The preprocessed text already folds in every include and define, so its hash is a complete cache key
+    shaderc::PreprocessedSourceCompilationResult preprocessed = compiler.PreprocessGlsl(source, kind, shader.path.c_str(), options);
+    if (preprocessed.GetCompilationStatus() != shaderc_compilation_status_success)
+        throw std::runtime_error("failed to preprocess shader: " + preprocessed.GetErrorMessage());
+
+    std::string text(preprocessed.cbegin(), preprocessed.cend());
+    uint64_t key = fnv1a(text.data(), text.size());
+    key = fnv1a(&kind, sizeof(kind), key);
+
+    if (dependencies != nullptr)
+        for (auto& include : includes)
+            dependencies->push_back(include.string());
+
+    std::stringstream name;
+    name << std::hex << key << ".spv";
+    std::filesystem::path cachePath = std::filesystem::path(cacheDirectory) / name.str();
+
+    std::ifstream cached(cachePath, std::ios::ate | std::ios::binary);
+    if (cached.is_open())
+    {
+        size_t fileSize = static_cast<size_t>(cached.tellg());
+        std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+        cached.seekg(0);
+        cached.read(reinterpret_cast<char*>(code.data()), code.size() * sizeof(uint32_t));
+        if (cached && !code.empty())
+            return code;
+    }
+
+    shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(text, kind, shader.path.c_str(), options);
+    if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+        throw std::runtime_error("failed to compile shader: " + result.GetErrorMessage());
+
+    std::vector<uint32_t> code(result.cbegin(), result.cend());
+
+    //write to a temporary name first so a concurrent reader never sees a partial file
+    std::filesystem::path tempPath = cachePath;
+    tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(code.data()), code.size() * sizeof(uint32_t));
+    }
+    std::error_code error;
+    std::filesystem::rename(tempPath, cachePath, error);
+
+    return code;
+}
+
+void ShaderCompiler_T::watch(const std::vector<ShaderSource>& shaders, const std::vector<std::string>& dependencies, std::function<void(std::vector<std::vector<uint32_t>>&)> onRebuilt)
+{
+    WatchEntry entry{ shaders, dependencies, std::move(onRebuilt) };
+    {
+        std::lock_guard<std::mutex> lock(watchMutex);
+        watchEntries.push_back(std::move(entry));
+    }
+    entriesChanged = true;
+
+    if (!running.exchange(true))
+        watcher = std::thread(&ShaderCompiler_T::watchLoop, this);
+}
+
+void ShaderCompiler_T::rebuildChanged(const std::set<std::string>& changedFiles)
+{
+    std::lock_guard<std::mutex> lock(watchMutex);
+    for (WatchEntry& entry : watchEntries)
+    {
+        bool affected = false;
+        for (auto& dependency : entry.dependencies)
+            if (changedFiles.count(dependency)) affected = true;
+        if (!affected) continue;
+
+        try
+        {
+            std::vector<std::string> dependencies;
+            std::vector<std::vector<uint32_t>> code;
+            for (auto& shader : entry.shaders)
+                code.push_back(compile(shader, &dependencies));
+
+            entry.dependencies = std::move(dependencies);
+            entry.onRebuilt(code);
+        }
+        catch (const std::exception& e)
+        {
+            //a broken edit keeps the last good pipeline running
+            std::cerr << "shader reload: " << e.what() << std::endl;
+        }
+    }
+}
+
+#ifdef __linux__
+void ShaderCompiler_T::watchLoop()
+{
+    int fd = inotify_init1(IN_NONBLOCK);
+    if (fd < 0)
+        return;
+
+    //watch directories rather than files, editors usually replace a file instead of writing it in place
+    std::unordered_map<int, std::filesystem::path> directories;
+    auto addWatches = [&]()
+    {
+        entriesChanged = false;
+        std::lock_guard<std::mutex> lock(watchMutex);
+        for (auto& entry : watchEntries)
+            for (auto& dependency : entry.dependencies)
+            {
+                std::filesystem::path directory = std::filesystem::path(dependency).parent_path();
+                int wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+                if (wd >= 0) directories[wd] = directory;
+            }
+    };
+    alignas(inotify_event) char buffer[4096];
+    while (running)
+    {
+        if (entriesChanged)
+            addWatches();
+
+        pollfd descriptor{ fd, POLLIN, 0 };
+        if (poll(&descriptor, 1, 100) <= 0)
+            continue;
+
+        std::set<std::string> changedFiles;
+        ssize_t length;
+        while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(ptr)->len)
+            {
+                inotify_event* event = reinterpret_cast<inotify_event*>(ptr);
+                if (event->len > 0 && directories.count(event->wd))
+                    changedFiles.insert((directories[event->wd] / event->name).string());
+            }
+        }
+
+        if (!changedFiles.empty())
+        {
+            rebuildChanged(changedFiles);
+            addWatches(); //a rebuild may have picked up new includes
+        }
+    }
+
+    close(fd);
+}
+#else
+void ShaderCompiler_T::watchLoop()
+{
+    //no inotify, fall back to polling modification times
+    std::unordered_map<std::string, std::filesystem::file_time_type> writeTimes;
+    while (running)
+    {
+        std::set<std::string> changedFiles;
+        {
+            std::lock_guard<std::mutex> lock(watchMutex);
+            for (auto& entry : watchEntries)
+                for (auto& dependency : entry.dependencies)
+                {
+                    std::error_code error;
+                    auto time = std::filesystem::last_write_time(dependency, error);
+                    if (error) continue;
+                    auto found = writeTimes.find(dependency);
+                    if (found != writeTimes.end() && found->second != time)
+                        changedFiles.insert(dependency);
+                    writeTimes[dependency] = time;
+                }
+        }
+
+        if (!changedFiles.empty())
+            rebuildChanged(changedFiles);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+}
+#endif
+
+
+static std::string readTextFile(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open())
+        throw std::runtime_error("failed to open file: " + path.string());
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+static uint64_t fnv1a(const void* data, size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+#endif
@@ -0,0 +1,306 @@
+#include "MYR.h"
+#include <algorithm>
+
+using namespace MYR;
+
+//Only the handful of SPIR-V opcodes needed to recover descriptor bindings and push constant blocks
+namespace
+{
+    enum Op : uint32_t
+    {
+        OpDecorate = 71,
+        OpMemberDecorate = 72,
+        OpTypeInt = 21,
+        OpTypeFloat = 22,
+        OpTypeVector = 23,
+        OpTypeMatrix = 24,
+        OpTypeImage = 25,
+        OpTypeSampler = 26,
+        OpTypeSampledImage = 27,
+        OpTypeArray = 28,
+        OpTypeRuntimeArray = 29,
+        OpTypeStruct = 30,
+        OpTypePointer = 32,
+        OpConstant = 43,
+        OpVariable = 59,
+    };
+
+    enum Decoration : uint32_t
+    {
+        DecorationBlock = 2,
+        DecorationBufferBlock = 3,
+        DecorationArrayStride = 6,
+        DecorationMatrixStride = 7,
+        DecorationBinding = 33,
+        DecorationDescriptorSet = 34,
+        DecorationOffset = 35,
+    };
+
+    enum StorageClass : uint32_t
+    {
+        StorageClassUniformConstant = 0,
+        StorageClassUniform = 2,
+        StorageClassPushConstant = 9,
+        StorageClassStorageBuffer = 12,
+    };
+
+    const uint32_t SpirvMagic = 0x07230203;
+    const uint32_t DimBuffer = 5;
+    const uint32_t DimSubpassData = 6;
+
+    struct SpirvId
+    {
+        uint32_t opcode = 0;
+        std::vector<uint32_t> operands; //everything after the result id
+
+        std::optional<uint32_t> set;
+        std::optional<uint32_t> binding;
+        bool block = false;
+        bool bufferBlock = false;
+        uint32_t arrayStride = 0;
+        std::unordered_map<uint32_t, uint32_t> memberOffsets;
+        std::unordered_map<uint32_t, uint32_t> memberMatrixStrides;
+    };
+
+    class SpirvModule
+    {
+    public:
+        SpirvModule(const std::vector<uint32_t>& code)
+        {
+            if (code.size() < 5 || code[0] != SpirvMagic)
+                throw std::runtime_error("failed to reflect shader: not SPIR-V!");
+
+            ids.resize(code[3]); //id bound
+            for (size_t i = 5; i < code.size();)
+            {
+                uint32_t opcode = code[i] & 0xFFFF;
+                uint32_t wordCount = code[i] >> 16;
+                if (wordCount == 0 || i + wordCount > code.size())
+                    throw std::runtime_error("failed to reflect shader: malformed SPIR-V!");
+
+                const uint32_t* words = &code[i + 1];
+                parse(opcode, words, wordCount - 1);
+                i += wordCount;
+            }
+        }
+
+        std::vector<SpirvId> ids;
+        std::vector<uint32_t> variables;
+
+        uint32_t sizeOf(uint32_t typeId, uint32_t matrixStride = 0) const
+        {
+            const SpirvId& type = ids[typeId];
+            switch (type.opcode)
+            {
+            case OpTypeInt:
+            case OpTypeFloat:
+                return type.operands[0] / 8;
+            case OpTypeVector:
+                return sizeOf(type.operands[0]) * type.operands[1];
+            case OpTypeMatrix:
+                if (matrixStride != 0)
+                    return matrixStride * type.operands[1];
+                return sizeOf(type.operands[0]) * type.operands[1];
+            case OpTypeArray:
+                return (type.arrayStride != 0 ? type.arrayStride : sizeOf(type.operands[0])) * constantValue(type.operands[1]);
+            case OpTypeStruct:
+            {
+                uint32_t size = 0;
+                for (uint32_t member = 0; member < type.operands.size(); member++)
+                {
+                    auto offset = type.memberOffsets.find(member);
+                    auto stride = type.memberMatrixStrides.find(member);
+                    uint32_t memberSize = sizeOf(type.operands[member], stride != type.memberMatrixStrides.end() ? stride->second : 0);
+                    size = std::max(size, (offset != type.memberOffsets.end() ? offset->second : 0) + memberSize);
+                }
+                return size;
+            }
+            default:
+                return 0;
+            }
+        }
+
+        uint32_t constantValue(uint32_t id) const
+        {
+            if (ids[id].opcode != OpConstant)
+                throw std::runtime_error("failed to reflect shader: specialization constant array sizes are not supported!");
+            return ids[id].operands[1];
+        }
+
+    private:
+        void parse(uint32_t opcode, const uint32_t* words, uint32_t count)
+        {
+            switch (opcode)
+            {
+            case OpDecorate:
+            {
+                SpirvId& target = ids[words[0]];
+                if (words[1] == DecorationDescriptorSet) target.set = words[2];
+                else if (words[1] == DecorationBinding) target.binding = words[2];
+                else if (words[1] == DecorationBlock) target.block = true;
+                else if (words[1] == DecorationBufferBlock) target.bufferBlock = true;
+                else if (words[1] == DecorationArrayStride) target.arrayStride = words[2];
+                break;
+            }
+            case OpMemberDecorate:
+            {
+                SpirvId& target = ids[words[0]];
+                if (words[2] == DecorationOffset) target.memberOffsets[words[1]] = words[3];
+                else if (words[2] == DecorationMatrixStride) target.memberMatrixStrides[words[1]] = words[3];
+                break;
+            }
+            case OpTypeInt:
+            case OpTypeFloat:
+            case OpTypeVector:
+            case OpTypeMatrix:
+            case OpTypeImage:
+            case OpTypeSampler:
+            case OpTypeSampledImage:
+            case OpTypeArray:
+            case OpTypeRuntimeArray:
+            case OpTypeStruct:
+            case OpTypePointer:
+                ids[words[0]].opcode = opcode;
+                ids[words[0]].operands.assign(words + 1, words + count);
+                break;
+            case OpConstant:
+            case OpVariable:
+                //result type comes first for these, keep it as operand 0
+                ids[words[1]].opcode = opcode;
+                ids[words[1]].operands.assign(words, words + count);
+                ids[words[1]].operands.erase(ids[words[1]].operands.begin() + 1);
+                if (opcode == OpVariable) variables.push_back(words[1]);
+                break;
+            default:
+                break;
+            }
+        }
+    };
+
+    VkDescriptorType descriptorTypeOf(const SpirvModule& module, uint32_t typeId, uint32_t storageClass)
+    {
+        const SpirvId& type = module.ids[typeId];
+        switch (type.opcode)
+        {
+        case OpTypeSampler:
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+        case OpTypeSampledImage:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        case OpTypeImage:
+        {
+            uint32_t dim = type.operands[1];
+            uint32_t sampled = type.operands[5];
+            if (dim == DimBuffer)
+                return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            if (dim == DimSubpassData)
+                return VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+            return sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+        case OpTypeStruct:
+            if (storageClass == StorageClassStorageBuffer || type.bufferBlock)
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        default:
+            throw std::runtime_error("failed to reflect shader: unsupported descriptor type!");
+        }
+    }
+}
+
+
+ShaderReflection MYR::reflectShader(const std::vector<uint32_t>& code, VkShaderStageFlagBits stage)
+{
+    SpirvModule module(code);
+    ShaderReflection reflection{};
+
+    for (uint32_t variableId : module.variables)
+    {
+        const SpirvId& variable = module.ids[variableId];
+        uint32_t storageClass = variable.operands[1];
+        const SpirvId& pointer = module.ids[variable.operands[0]];
+        uint32_t typeId = pointer.operands[1];
+
+        if (storageClass == StorageClassPushConstant)
+        {
+            const SpirvId& block = module.ids[typeId];
+            uint32_t start = UINT32_MAX;
+            for (auto& kv : block.memberOffsets)
+                start = std::min(start, kv.second);
+            if (start == UINT32_MAX) start = 0;
+
+            VkPushConstantRange range{};
+            range.stageFlags = stage;
+            range.offset = start;
+            range.size = module.sizeOf(typeId) - start;
+            reflection.pushConstantRanges.push_back(range);
+            continue;
+        }
+
+        if (storageClass != StorageClassUniform && storageClass != StorageClassUniformConstant && storageClass != StorageClassStorageBuffer)
+            continue;
+
+        VkDescriptorSetLayoutBinding binding{};
+        binding.binding = variable.binding.value_or(0);
+        binding.descriptorCount = 1;
+        binding.stageFlags = stage;
+
+        //arrays of descriptors, a runtime array is left at count 0 and sized by whoever owns that set
+        const SpirvId* type = &module.ids[typeId];
+        if (type->opcode == OpTypeArray)
+        {
+            binding.descriptorCount = module.constantValue(type->operands[1]);
+            typeId = type->operands[0];
+        }
+        else if (type->opcode == OpTypeRuntimeArray)
+        {
+            binding.descriptorCount = 0;
+            typeId = type->operands[0];
+        }
+        binding.descriptorType = descriptorTypeOf(module, typeId, storageClass);
+
+        uint32_t set = variable.set.value_or(0);
+        if (reflection.sets.size() <= set)
+            reflection.sets.resize(set + 1);
+        reflection.sets[set].push_back(binding);
+    }
+
+    return reflection;
+}
+
+void MYR::mergeReflection(ShaderReflection& into, const ShaderReflection& from)
+{
+    if (into.sets.size() < from.sets.size())
+        into.sets.resize(from.sets.size());
+
+    for (size_t set = 0; set < from.sets.size(); set++)
+        for (const VkDescriptorSetLayoutBinding& binding : from.sets[set])
+        {
+            auto existing = std::find_if(into.sets[set].begin(), into.sets[set].end(),
+                [&binding](const VkDescriptorSetLayoutBinding& other) { return other.binding == binding.binding; });
+
+            if (existing == into.sets[set].end())
+                into.sets[set].push_back(binding);
+            else if (existing->descriptorType != binding.descriptorType)
+                throw std::runtime_error("failed to merge shader reflection: stages disagree on a descriptor type!");
+            else
+            {
+                existing->stageFlags |= binding.stageFlags;
+                existing->descriptorCount = std::max(existing->descriptorCount, binding.descriptorCount);
+            }
+        }
+
+    //stages with an identical block share one range, each stage may only appear in one range
+    for (const VkPushConstantRange& range : from.pushConstantRanges)
+    {
+        auto existing = std::find_if(into.pushConstantRanges.begin(), into.pushConstantRanges.end(),
+            [&range](const VkPushConstantRange& other) { return other.offset == range.offset && other.size == range.size; });
+
+        if (existing == into.pushConstantRanges.end())
+            into.pushConstantRanges.push_back(range);
+        else
+            existing->stageFlags |= range.stageFlags;
+    }
+
+    for (auto& bindings : into.sets)
+        std::sort(bindings.begin(), bindings.end(),
+            [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+}
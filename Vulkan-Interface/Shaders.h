@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+
+namespace MYR
+{
+    // SPIR-V words generated from shader.vert and shader.frag by the custom build step (glslc -mfmt=num), see Compile.bat
+    constexpr uint32_t embeddedVertShader[] =
+    {
+        #include "vert.spv.inc"
+    };
+
+    constexpr uint32_t embeddedFragShader[] =
+    {
+        #include "frag.spv.inc"
+    };
+}
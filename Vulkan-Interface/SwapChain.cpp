@@ -6,7 +6,7 @@ using namespace MYR;
 
 
 VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, PresentMode mode);
 VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window);
 bool hasStencilComponent(VkFormat format) { return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT; }
 
@@ -14,6 +14,8 @@ SwapChain_T::SwapChain_T(Device device) : device(device) {}
 SwapChain_T::~SwapChain_T()
 {
     vkDestroyImageView(device->getHandle(), depthImageView, nullptr);
+    if (imageManager != nullptr)
+        imageManager->destroyImage(depthImage);
 
     for (auto framebuffer : Framebuffers) {
         vkDestroyFramebuffer(device->getHandle(), framebuffer, nullptr);
@@ -23,18 +25,26 @@ SwapChain_T::~SwapChain_T()
         vkDestroyImageView(device->getHandle(), imageView, nullptr);
     }
 
-    vkDestroySwapchainKHR(device->getHandle(), swapChain, nullptr);
+    if (offscreen)
+    {
+        for (VkImage image : swapChainImages)
+            imageManager->destroyImage(image);
+    }
+    else
+        vkDestroySwapchainKHR(device->getHandle(), swapChain, nullptr);
 }
 
-void SwapChain_T::initSwapChain(VkSurfaceKHR surface, GLFWwindow*  window)
+void SwapChain_T::initSwapChain(VkSurfaceKHR surface, GLFWwindow*  window, VkSwapchainKHR oldSwapChain)
 {
     SwapChainSupportDetails swapChainSupport = device->querySwapChainSupport();
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = chooseSwapPresentMode(swapChainSupport.presentModes, presentPolicy.mode);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities,window);
 
     imageCount = swapChainSupport.capabilities.minImageCount + 1; //try for one more than the min
+    if (presentPolicy.imageCount != 0)
+        imageCount = std::max(presentPolicy.imageCount, swapChainSupport.capabilities.minImageCount);
     if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) //==0 would indicate unlimited images are supported
     {
         imageCount = swapChainSupport.capabilities.maxImageCount;
@@ -66,7 +76,7 @@ void SwapChain_T::initSwapChain(VkSurfaceKHR surface, GLFWwindow*  window)
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;//we simply ignore the alpha channel, hence VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;//means that we don't care about the color of pixels that are obscured
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    createInfo.oldSwapchain = oldSwapChain; //lets the driver hand resources over, the old one is retired but may still finish presenting
 
     if (vkCreateSwapchainKHR(device->getHandle(), &createInfo, nullptr, &swapChain) != VK_SUCCESS)
     {
@@ -82,6 +92,22 @@ void SwapChain_T::initSwapChain(VkSurfaceKHR surface, GLFWwindow*  window)
     swapChainImageFormat = surfaceFormat.format;
     swapChainExtent = extent;
 }
+void SwapChain_T::initOffscreen(VkExtent2D extent, VkFormat format, uint32_t imageCount, ImageManager imageManager)
+{
+    this->imageManager = imageManager;
+    offscreen = true;
+    this->imageCount = imageCount;
+
+    //rendered like swapchain images, then copied out instead of presented
+    swapChainImages.resize(imageCount);
+    for (VkImage& image : swapChainImages)
+        imageManager->createImage(extent.width, extent.height, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &image);
+
+    swapChainImageFormat = format;
+    swapChainExtent = extent;
+}
+
 void SwapChain_T::initImageViews() {
     swapChainImageViews.resize(swapChainImages.size());
     for (size_t i = 0; i < swapChainImages.size(); i++) {
@@ -132,13 +158,18 @@ void SwapChain_T::initFramebuffers(VkRenderPass renderPass)
 
 void SwapChain_T::initDepthStencil(ImageManager imageManager)
 {
-    VkFormat depthFormat{ device->findDepthFormat() };
+    this->imageManager = imageManager;
+    depthFormat = device->findDepthFormat();
 
-    imageManager->createImage(getExtent().width,getExtent().height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &depthImage);
-    depthImageView = imageManager->createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+    //depth is cleared on load and discarded on store, so it never has to exist outside the render pass
+    VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if (device->supportsLazilyAllocatedMemory())
+        memoryProperties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
 
-    imageManager->transitionImageLayout(depthImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, hasStencilComponent(depthFormat));
+    imageManager->createImage(getExtent().width,getExtent().height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, memoryProperties, &depthImage);
+    depthImageView = imageManager->createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
 
+    //no transition here, the render pass takes the image from UNDEFINED every frame
 }
 
 
@@ -173,17 +204,22 @@ VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>
 
     return availableFormats[0];
 }
-VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes, PresentMode mode)
 {
-    //Look for VK_PRESENT_MODE_MAILBOX_KHR but else we are guaranteed to have VK_PRESENT_MODE_FIFO_KHR.
-    for (const auto& availablePresentMode : availablePresentModes)
+    //walk the preference list of the requested mode, VK_PRESENT_MODE_FIFO_KHR is guaranteed to be available
+    std::vector<VkPresentModeKHR> preferred;
+    switch (mode)
     {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR)
-        {
-            return availablePresentMode;
-        }
+    case PresentMode::LowLatency: preferred = { VK_PRESENT_MODE_MAILBOX_KHR }; break;
+    case PresentMode::Uncapped: preferred = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR }; break;
+    case PresentMode::Adaptive: preferred = { VK_PRESENT_MODE_FIFO_RELAXED_KHR }; break;
+    default: break;
     }
 
+    for (VkPresentModeKHR presentMode : preferred)
+        if (std::find(availablePresentModes.begin(), availablePresentModes.end(), presentMode) != availablePresentModes.end())
+            return presentMode;
+
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, GLFWwindow* window)
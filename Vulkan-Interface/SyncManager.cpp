@@ -26,13 +26,91 @@ VkSemaphore SyncManager_T::createSemaphore()
     return semaphores[semaphores.size()-1];
 }
 
-VkFence SyncManager_T::createFence()
+VkFence SyncManager_T::createFence(bool signaled)
 {
     fences.resize(fences.size() + 1);
     VkFenceCreateInfo fenceInfo{};
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    fenceInfo.flags = signaled ? VK_FENCE_CREATE_SIGNALED_BIT : 0;
     if (vkCreateFence(device->getHandle(), &fenceInfo, nullptr, &fences[fences.size()-1]) != VK_SUCCESS)
         throw std::runtime_error("failed to create Fence object!");
     return fences[fences.size()-1];
-}
\ No newline at end of file
+}
+
+VkSemaphore SyncManager_T::createTimelineSemaphore(uint64_t initialValue)
+{
+    if (!device->supportsTimelineSemaphore())
+        throw std::runtime_error("failed to create timeline Semaphore: timelineSemaphore is not supported!");
+
+    semaphores.resize(semaphores.size() + 1);
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = initialValue;
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(device->getHandle(), &semaphoreInfo, nullptr, &semaphores[semaphores.size()-1]) != VK_SUCCESS)
+        throw std::runtime_error("failed to create timeline Semaphore object!");
+    return semaphores[semaphores.size()-1];
+}
+
+void SyncManager_T::waitTimeline(VkSemaphore timeline, uint64_t value, uint64_t timeout)
+{
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline;
+    waitInfo.pValues = &value;
+    VkResult result = vkWaitSemaphores(device->getHandle(), &waitInfo, timeout);
+    if (result != VK_SUCCESS && result != VK_TIMEOUT)
+        throw std::runtime_error("failed to wait on timeline Semaphore!");
+}
+
+uint64_t SyncManager_T::getTimelineValue(VkSemaphore timeline)
+{
+    uint64_t value = 0;
+    if (vkGetSemaphoreCounterValue(device->getHandle(), timeline, &value) != VK_SUCCESS)
+        throw std::runtime_error("failed to read timeline Semaphore value!");
+    return value;
+}
+
+VkSemaphore SyncManager_T::acquireSemaphore()
+{
+    if (freeSemaphores.empty())
+        return createSemaphore();
+
+    VkSemaphore semaphore = freeSemaphores.back();
+    freeSemaphores.pop_back();
+    return semaphore;
+}
+
+void SyncManager_T::releaseSemaphore(VkSemaphore semaphore)
+{
+    if (semaphore != VK_NULL_HANDLE)
+        freeSemaphores.push_back(semaphore);
+}
+
+VkFence SyncManager_T::acquireFence()
+{
+    //one vkResetFences for everything released since the last refill
+    if (freeFences.empty() && !fencesToReset.empty())
+    {
+        if (vkResetFences(device->getHandle(), static_cast<uint32_t>(fencesToReset.size()), fencesToReset.data()) != VK_SUCCESS)
+            throw std::runtime_error("failed to reset Fence objects!");
+        freeFences.swap(fencesToReset);
+    }
+
+    if (freeFences.empty())
+        return createFence(false);
+
+    VkFence fence = freeFences.back();
+    freeFences.pop_back();
+    return fence;
+}
+
+void SyncManager_T::releaseFence(VkFence fence)
+{
+    if (fence != VK_NULL_HANDLE)
+        fencesToReset.push_back(fence);
+}
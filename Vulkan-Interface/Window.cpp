@@ -9,6 +9,8 @@ void framebufferResizeCallback(GLFWwindow*, int, int);
 Window_T::Window_T(uint32_t width, uint32_t height) : WIDTH(width), HEIGHT(height) {}
 Window_T::~Window_T()
 {
+    if (window == nullptr)
+        return;
     glfwDestroyWindow(window);
     glfwTerminate();
 }